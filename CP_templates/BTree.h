@@ -0,0 +1,780 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <bit>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "NodePool.h"
+
+template <typename T>
+class BTree
+{
+public:
+    BTree() = default;
+
+    BTree(const BTree& bTree) = default;
+
+    BTree& operator=(const BTree& bTree) = default;
+
+    BTree(BTree&& bTree) :
+        m_leaves{ std::move(bTree.m_leaves) },
+        m_inners{ std::move(bTree.m_inners) },
+        m_root{ bTree.m_root },
+        m_height{ bTree.m_height },
+        m_size{ bTree.m_size }
+    {
+        bTree.m_leaves.clear();
+        bTree.m_inners.clear();
+        bTree.m_root = 0;
+        bTree.m_height = 0;
+        bTree.m_size = 0;
+    }
+
+    BTree& operator=(BTree&& bTree)
+    {
+        if (this != &bTree)
+        {
+            m_leaves = std::move(bTree.m_leaves);
+            m_inners = std::move(bTree.m_inners);
+            m_root = bTree.m_root;
+            m_height = bTree.m_height;
+            m_size = bTree.m_size;
+
+            bTree.m_leaves.clear();
+            bTree.m_inners.clear();
+            bTree.m_root = 0;
+            bTree.m_height = 0;
+            bTree.m_size = 0;
+        }
+
+        return *this;
+    }
+
+    void insert(const T& val, std::uint64_t count = 1)
+    {
+        if (!count)
+        {
+            return;
+        }
+
+        m_size += count;
+
+        if (!m_root)
+        {
+            Leaf leaf{};
+            leaf.keys[0] = val.key;
+            leaf.counts[0] = count;
+            leaf.vals[0] = val;
+            leaf.size = 1;
+
+            m_root = m_leaves.allocate(leaf);
+            m_height = 0;
+
+            return;
+        }
+
+        std::uint32_t node = this->findLeaf(val.key);
+        std::uint32_t pos = BTree::countKeys<false>(m_leaves[node], val.key);
+
+        if (pos < m_leaves[node].size && m_leaves[node].keys[pos] == val.key)
+        {
+            m_leaves[node].counts[pos] += count;
+        }
+        else
+        {
+            BTree::insertEntry(m_leaves[node], pos, val.key, count, val, 0);
+        }
+
+        std::uint32_t split = BTree::splitIfFull(m_leaves, node);
+        for (std::uint64_t level = m_path.size(); level > 0; level--)
+        {
+            std::uint32_t parent = m_path[level - 1].first;
+            std::uint32_t idx = m_path[level - 1].second;
+            bool isLeafChild = level == m_path.size();
+
+            this->refreshEntry(parent, idx, isLeafChild);
+
+            if (split)
+            {
+                KeyType separator = isLeafChild ? m_leaves[split].keys[0] : m_inners[split].keys[0];
+
+                BTree::insertEntry(m_inners[parent], idx + 1, separator, 0, T{}, split);
+                this->refreshEntry(parent, idx + 1, isLeafChild);
+
+                split = BTree::splitIfFull(m_inners, parent);
+            }
+        }
+
+        if (split)
+        {
+            Inner root{};
+            root.size = 2;
+            root.keys[1] = m_height ? m_inners[split].keys[0] : m_leaves[split].keys[0];
+            root.children[0] = m_root;
+            root.children[1] = split;
+
+            m_root = m_inners.allocate(root);
+            this->refreshEntry(m_root, 0, !m_height);
+            this->refreshEntry(m_root, 1, !m_height);
+            m_height++;
+        }
+    }
+
+    std::uint64_t count(const T& val) const
+    {
+        if (!m_root)
+        {
+            return 0;
+        }
+
+        std::uint32_t node = m_root;
+        for (std::uint32_t level = 0; level < m_height; level++)
+        {
+            node = m_inners[node].children[BTree::findChild(m_inners[node], val.key)];
+        }
+
+        const Leaf& leaf = m_leaves[node];
+        std::uint32_t pos = BTree::countKeys<false>(leaf, val.key);
+
+        return pos < leaf.size && leaf.keys[pos] == val.key ? leaf.counts[pos] : 0;
+    }
+
+    std::uint64_t erase(const T& val, std::uint64_t count = 1)
+    {
+        if (!count || !m_root)
+        {
+            return 0;
+        }
+
+        std::uint32_t node = this->findLeaf(val.key);
+        std::uint32_t pos = BTree::countKeys<false>(m_leaves[node], val.key);
+
+        if (pos == m_leaves[node].size || m_leaves[node].keys[pos] != val.key)
+        {
+            return 0;
+        }
+
+        std::uint64_t erased = std::min(count, m_leaves[node].counts[pos]);
+        m_size -= erased;
+
+        m_leaves[node].counts[pos] -= erased;
+        if (!m_leaves[node].counts[pos])
+        {
+            BTree::eraseEntry(m_leaves[node], pos);
+        }
+
+        for (std::uint64_t level = m_path.size(); level > 0; level--)
+        {
+            std::uint32_t parent = m_path[level - 1].first;
+            std::uint32_t idx = m_path[level - 1].second;
+            bool isLeafChild = level == m_path.size();
+
+            this->refreshEntry(parent, idx, isLeafChild);
+
+            if ((isLeafChild ? m_leaves[node].size : m_inners[node].size) < m_minSize)
+            {
+                if (isLeafChild)
+                {
+                    this->rebalance(m_leaves, parent, idx);
+                }
+                else
+                {
+                    this->rebalance(m_inners, parent, idx);
+                }
+            }
+
+            node = parent;
+        }
+
+        if (m_height && m_inners[m_root].size == 1)
+        {
+            std::uint32_t oldRoot = m_root;
+            m_root = m_inners[oldRoot].children[0];
+            m_inners.deallocate(oldRoot);
+            m_height--;
+        }
+        if (!m_height && !m_leaves[m_root].size)
+        {
+            m_leaves.deallocate(m_root);
+            m_root = 0;
+        }
+
+        return erased;
+    }
+
+    std::vector<T> getRange(std::uint64_t l, std::uint64_t r) const
+    {
+        std::vector<T> res{};
+
+        if (l > r || l >= m_size)
+        {
+            return res;
+        }
+
+        std::uint64_t remaining = std::min(r, m_size - 1) - l + 1;
+        res.reserve(remaining);
+
+        std::uint64_t offset = l;
+        std::uint32_t node = this->findKth(offset);
+        std::uint32_t pos = BTree::findCount(m_leaves[node], offset);
+
+        while (remaining)
+        {
+            const Leaf& leaf = m_leaves[node];
+
+            for (; pos < leaf.size && remaining; pos++)
+            {
+                std::uint64_t taken = std::min(leaf.counts[pos] - offset, remaining);
+                res.insert(res.end(), taken, leaf.vals[pos]);
+
+                remaining -= taken;
+                offset = 0;
+            }
+
+            node = leaf.next;
+            pos = 0;
+        }
+
+        return res;
+    }
+
+    T getKth(std::uint64_t k) const
+    {
+        if (k >= m_size)
+        {
+            return T{};
+        }
+
+        std::uint32_t node = this->findKth(k);
+
+        return m_leaves[node].vals[BTree::findCount(m_leaves[node], k)];
+    }
+
+    T getRangeQuery(std::uint64_t l, std::uint64_t r) const
+    {
+        T res{};
+
+        if (m_root && l <= r)
+        {
+            this->getRangeQuery(m_root, m_height, 0, res, l, r);
+        }
+
+        return res;
+    }
+
+    std::uint64_t getDepth() const
+    {
+        return m_root ? m_height + 1 : 0;
+    }
+
+    std::uint64_t size() const
+    {
+        return m_size;
+    }
+
+    T getNearestSmaller(const T& val) const
+    {
+        if (!m_size)
+        {
+            return T{};
+        }
+
+        std::uint64_t rank = this->getRank<true>(val.key);
+
+        return this->getKth(rank ? rank - 1 : 0);
+    }
+
+    T getNearestBigger(const T& val) const
+    {
+        if (!m_size)
+        {
+            return T{};
+        }
+
+        std::uint64_t rank = this->getRank<false>(val.key);
+
+        return this->getKth(rank < m_size ? rank : m_size - 1);
+    }
+
+    std::uint64_t getSmallestK(const T& val) const
+    {
+        return this->count(val) ? this->getRank<false>(val.key) : m_size;
+    }
+
+    std::uint64_t getBiggestK(const T& val) const
+    {
+        std::uint64_t valCount = this->count(val);
+
+        return valCount ? this->getRank<false>(val.key) + valCount - 1 : m_size;
+    }
+
+    void reserve(std::uint64_t elementsCount)
+    {
+        m_leaves.reserve(elementsCount / m_minSize + 1);
+        m_inners.reserve(elementsCount / (m_minSize * m_minSize) + 1);
+    }
+
+private:
+    using KeyType = std::remove_cv_t<decltype(T::key)>;
+
+    static constexpr std::uint32_t m_order = 32;
+    static constexpr std::uint32_t m_minSize = m_order / 2;
+
+    struct alignas(64) Leaf
+    {
+        KeyType keys[m_order]{};
+        std::uint64_t counts[m_order]{};
+        std::uint32_t size = 0;
+        std::uint32_t next = 0;
+        T vals[m_order]{};
+    };
+
+    struct alignas(64) Inner
+    {
+        KeyType keys[m_order]{};
+        std::uint64_t counts[m_order]{};
+        std::uint32_t children[m_order]{};
+        std::uint32_t size = 0;
+        T vals[m_order]{};
+    };
+
+    template <bool orEqual, typename Node>
+    static std::uint32_t countKeys(const Node& node, const KeyType& key, std::uint32_t first = 0)
+    {
+#ifdef __AVX2__
+        if constexpr (std::is_same_v<KeyType, std::int64_t>)
+        {
+            __m256i keyVec = _mm256_set1_epi64x(key);
+
+            std::uint64_t mask = 0;
+            for (std::uint32_t i = 0; i < m_order; i += 4)
+            {
+                __m256i keysVec = _mm256_load_si256((const __m256i*)(node.keys + i));
+                __m256i cmp = orEqual ? _mm256_cmpgt_epi64(keysVec, keyVec) : _mm256_cmpgt_epi64(keyVec, keysVec);
+                mask |= (std::uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(cmp)) << i;
+            }
+
+            if constexpr (orEqual)
+            {
+                mask = ~mask;
+            }
+
+            return (std::uint32_t)std::popcount(mask & (((std::uint64_t)1 << node.size) - ((std::uint64_t)1 << first)));
+        }
+#endif
+
+        std::uint32_t res = 0;
+        for (std::uint32_t i = first; i < node.size; i++)
+        {
+            res += orEqual ? !(key < node.keys[i]) : node.keys[i] < key;
+        }
+
+        return res;
+    }
+
+    static std::uint32_t findChild(const Inner& node, const KeyType& key)
+    {
+        return BTree::countKeys<true>(node, key, 1);
+    }
+
+    template <typename Node>
+    static std::uint32_t findCount(const Node& node, std::uint64_t& k)
+    {
+        std::uint32_t pos = 0;
+        while (k >= node.counts[pos])
+        {
+            k -= node.counts[pos];
+            pos++;
+        }
+
+        return pos;
+    }
+
+    std::uint32_t findLeaf(const KeyType& key)
+    {
+        m_path.clear();
+
+        std::uint32_t node = m_root;
+        for (std::uint32_t level = 0; level < m_height; level++)
+        {
+            std::uint32_t idx = BTree::findChild(m_inners[node], key);
+            m_path.push_back({ node, idx });
+            node = m_inners[node].children[idx];
+        }
+
+        return node;
+    }
+
+    std::uint32_t findKth(std::uint64_t& k) const
+    {
+        std::uint32_t node = m_root;
+        for (std::uint32_t level = 0; level < m_height; level++)
+        {
+            node = m_inners[node].children[BTree::findCount(m_inners[node], k)];
+        }
+
+        return node;
+    }
+
+    template <bool orEqual>
+    std::uint64_t getRank(const KeyType& key) const
+    {
+        std::uint64_t rank = 0;
+
+        std::uint32_t node = m_root;
+        for (std::uint32_t level = 0; level < m_height; level++)
+        {
+            const Inner& inner = m_inners[node];
+            std::uint32_t idx = BTree::findChild(inner, key);
+            for (std::uint32_t i = 0; i < idx; i++)
+            {
+                rank += inner.counts[i];
+            }
+
+            node = inner.children[idx];
+        }
+
+        const Leaf& leaf = m_leaves[node];
+        std::uint32_t pos = BTree::countKeys<orEqual>(leaf, key);
+        for (std::uint32_t i = 0; i < pos; i++)
+        {
+            rank += leaf.counts[i];
+        }
+
+        return rank;
+    }
+
+    void getRangeQuery(std::uint32_t node, std::uint32_t height, std::uint64_t k, T& res, std::uint64_t l, std::uint64_t r) const
+    {
+        if (!height)
+        {
+            const Leaf& leaf = m_leaves[node];
+
+            for (std::uint32_t i = 0; i < leaf.size && k <= r; i++)
+            {
+                std::uint64_t end = k + leaf.counts[i];
+                if (end > l)
+                {
+                    res = T::calc(res, T::calcMany(leaf.vals[i], std::min(r, end - 1) - std::max(l, k) + 1));
+                }
+
+                k = end;
+            }
+
+            return;
+        }
+
+        const Inner& inner = m_inners[node];
+
+        for (std::uint32_t i = 0; i < inner.size && k <= r; i++)
+        {
+            std::uint64_t end = k + inner.counts[i];
+
+            if (end > l)
+            {
+                if (k < l || end - 1 > r)
+                {
+                    this->getRangeQuery(inner.children[i], height - 1, k, res, l, r);
+                }
+                else
+                {
+                    res = T::calc(res, inner.vals[i]);
+                }
+            }
+
+            k = end;
+        }
+    }
+
+    void refreshEntry(std::uint32_t parent, std::uint32_t idx, bool isLeafChild)
+    {
+        std::uint32_t child = m_inners[parent].children[idx];
+
+        std::uint64_t count = 0;
+        T val{};
+        if (isLeafChild)
+        {
+            const Leaf& leaf = m_leaves[child];
+            for (std::uint32_t i = 0; i < leaf.size; i++)
+            {
+                T entry = T::calcMany(leaf.vals[i], leaf.counts[i]);
+
+                count += leaf.counts[i];
+                val = i ? T::calc(val, entry) : entry;
+            }
+        }
+        else
+        {
+            const Inner& inner = m_inners[child];
+            for (std::uint32_t i = 0; i < inner.size; i++)
+            {
+                count += inner.counts[i];
+                val = i ? T::calc(val, inner.vals[i]) : inner.vals[i];
+            }
+        }
+
+        m_inners[parent].counts[idx] = count;
+        m_inners[parent].vals[idx] = val;
+    }
+
+    template <typename Node>
+    static void insertEntry(Node& node, std::uint32_t pos, const KeyType& key, std::uint64_t count, const T& val, std::uint32_t child)
+    {
+        std::copy_backward(node.keys + pos, node.keys + node.size, node.keys + node.size + 1);
+        std::copy_backward(node.counts + pos, node.counts + node.size, node.counts + node.size + 1);
+        std::copy_backward(node.vals + pos, node.vals + node.size, node.vals + node.size + 1);
+
+        node.keys[pos] = key;
+        node.counts[pos] = count;
+        node.vals[pos] = val;
+
+        if constexpr (std::is_same_v<Node, Inner>)
+        {
+            std::copy_backward(node.children + pos, node.children + node.size, node.children + node.size + 1);
+            node.children[pos] = child;
+        }
+
+        node.size++;
+    }
+
+    template <typename Node>
+    static void eraseEntry(Node& node, std::uint32_t pos)
+    {
+        std::copy(node.keys + pos + 1, node.keys + node.size, node.keys + pos);
+        std::copy(node.counts + pos + 1, node.counts + node.size, node.counts + pos);
+        std::copy(node.vals + pos + 1, node.vals + node.size, node.vals + pos);
+
+        if constexpr (std::is_same_v<Node, Inner>)
+        {
+            std::copy(node.children + pos + 1, node.children + node.size, node.children + pos);
+        }
+
+        node.size--;
+    }
+
+    template <typename Node>
+    static void moveEntries(Node& fromNode, std::uint32_t fromPos, Node& toNode, std::uint32_t toPos, std::uint32_t count)
+    {
+        std::copy_backward(toNode.keys + toPos, toNode.keys + toNode.size, toNode.keys + toNode.size + count);
+        std::copy_backward(toNode.counts + toPos, toNode.counts + toNode.size, toNode.counts + toNode.size + count);
+        std::copy_backward(toNode.vals + toPos, toNode.vals + toNode.size, toNode.vals + toNode.size + count);
+
+        std::copy(fromNode.keys + fromPos, fromNode.keys + fromPos + count, toNode.keys + toPos);
+        std::copy(fromNode.counts + fromPos, fromNode.counts + fromPos + count, toNode.counts + toPos);
+        std::copy(fromNode.vals + fromPos, fromNode.vals + fromPos + count, toNode.vals + toPos);
+
+        std::copy(fromNode.keys + fromPos + count, fromNode.keys + fromNode.size, fromNode.keys + fromPos);
+        std::copy(fromNode.counts + fromPos + count, fromNode.counts + fromNode.size, fromNode.counts + fromPos);
+        std::copy(fromNode.vals + fromPos + count, fromNode.vals + fromNode.size, fromNode.vals + fromPos);
+
+        if constexpr (std::is_same_v<Node, Inner>)
+        {
+            std::copy_backward(toNode.children + toPos, toNode.children + toNode.size, toNode.children + toNode.size + count);
+            std::copy(fromNode.children + fromPos, fromNode.children + fromPos + count, toNode.children + toPos);
+            std::copy(fromNode.children + fromPos + count, fromNode.children + fromNode.size, fromNode.children + fromPos);
+        }
+
+        toNode.size += count;
+        fromNode.size -= count;
+    }
+
+    template <typename Node>
+    static std::uint32_t splitIfFull(FreeListPool<Node>& pool, std::uint32_t node)
+    {
+        if (pool[node].size < m_order)
+        {
+            return 0;
+        }
+
+        std::uint32_t split = pool.allocate(Node{});
+        BTree::moveEntries(pool[node], m_minSize, pool[split], 0, m_order - m_minSize);
+
+        if constexpr (std::is_same_v<Node, Leaf>)
+        {
+            pool[split].next = pool[node].next;
+            pool[node].next = split;
+        }
+
+        return split;
+    }
+
+    template <typename Node>
+    void rebalance(FreeListPool<Node>& pool, std::uint32_t parent, std::uint32_t idx)
+    {
+        constexpr bool isLeafChild = std::is_same_v<Node, Leaf>;
+
+        if (m_inners[parent].size < 2)
+        {
+            return;
+        }
+
+        std::uint32_t leftIdx = idx ? idx - 1 : idx;
+        std::uint32_t left = m_inners[parent].children[leftIdx];
+        std::uint32_t right = m_inners[parent].children[leftIdx + 1];
+
+        if constexpr (std::is_same_v<Node, Inner>)
+        {
+            pool[right].keys[0] = m_inners[parent].keys[leftIdx + 1];
+        }
+
+        std::uint32_t total = pool[left].size + pool[right].size;
+        if (total < m_order)
+        {
+            BTree::moveEntries(pool[right], 0, pool[left], pool[left].size, pool[right].size);
+
+            if constexpr (std::is_same_v<Node, Leaf>)
+            {
+                pool[left].next = pool[right].next;
+            }
+
+            pool.deallocate(right);
+            BTree::eraseEntry(m_inners[parent], leftIdx + 1);
+            this->refreshEntry(parent, leftIdx, isLeafChild);
+
+            return;
+        }
+
+        std::uint32_t leftSize = total / 2;
+        if (pool[left].size < leftSize)
+        {
+            BTree::moveEntries(pool[right], 0, pool[left], pool[left].size, leftSize - pool[left].size);
+        }
+        else
+        {
+            BTree::moveEntries(pool[left], leftSize, pool[right], 0, pool[left].size - leftSize);
+        }
+
+        m_inners[parent].keys[leftIdx + 1] = pool[right].keys[0];
+        this->refreshEntry(parent, leftIdx, isLeafChild);
+        this->refreshEntry(parent, leftIdx + 1, isLeafChild);
+    }
+
+    FreeListPool<Leaf> m_leaves{};
+    FreeListPool<Inner> m_inners{};
+    std::uint32_t m_root = 0;
+    std::uint32_t m_height = 0;
+    std::uint64_t m_size = 0;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_path{};
+};
+
+struct Key
+{
+    Key() = default;
+
+    Key(std::int64_t val) :
+        key{ val }
+    {
+    }
+
+    std::int64_t key = 0;
+
+    static Key calc(const Key& firstKey, const Key& secondKey)
+    {
+        return Key(firstKey.key);
+    }
+
+    static Key calcMany(const Key& key, std::uint64_t count)
+    {
+        return Key(key.key);
+    }
+};
+
+struct Min
+{
+    Min() = default;
+
+    Min(std::int64_t val) :
+        key{ val },
+        min{ val }
+    {
+    }
+
+    Min(std::int64_t key, std::int64_t min) :
+        key{ key },
+        min{ min }
+    {
+    }
+
+    std::int64_t key = std::numeric_limits<std::int64_t>::max();
+
+    std::int64_t min = std::numeric_limits<std::int64_t>::max();
+
+    static Min calc(const Min& firstMin, const Min& secondMin)
+    {
+        return Min(firstMin.key, std::min(firstMin.min, secondMin.min));
+    }
+
+    static Min calcMany(const Min& min, std::uint64_t count)
+    {
+        return count ? Min(min.key) : Min{};
+    }
+};
+
+struct Max
+{
+    Max() = default;
+
+    Max(std::int64_t val) :
+        key{ val },
+        max{ val }
+    {
+    }
+
+    Max(std::int64_t key, std::int64_t max) :
+        key{ key },
+        max{ max }
+    {
+    }
+
+    std::int64_t key = std::numeric_limits<std::int64_t>::min();
+
+    std::int64_t max = std::numeric_limits<std::int64_t>::min();
+
+    static Max calc(const Max& firstMax, const Max& secondMax)
+    {
+        return Max(firstMax.key, std::max(firstMax.max, secondMax.max));
+    }
+
+    static Max calcMany(const Max& max, std::uint64_t count)
+    {
+        return count ? Max(max.key) : Max{};
+    }
+};
+
+struct Sum
+{
+    Sum() = default;
+
+    Sum(std::int64_t val) :
+        key{ val },
+        sum{ val }
+    {
+    }
+
+    Sum(std::int64_t key, std::int64_t sum) :
+        key{ key },
+        sum{ sum }
+    {
+    }
+
+    std::int64_t key = 0;
+
+    std::int64_t sum = 0;
+
+    static Sum calc(const Sum& firstSum, const Sum& secondSum)
+    {
+        return Sum(firstSum.key, firstSum.sum + secondSum.sum);
+    }
+
+    static Sum calcMany(const Sum& sum, std::uint64_t count)
+    {
+        return Sum(sum.key, sum.key * (std::int64_t)count);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+template <typename T>
+class FenwickTree
+{
+public:
+    FenwickTree(std::uint64_t size) :
+        m_size{ size },
+        m_tree(size + 1, T{})
+    {
+    }
+
+    FenwickTree(const std::vector<T>& elems) :
+        m_size{ elems.size() },
+        m_tree(elems.size() + 1, T{})
+    {
+        for (std::uint64_t i = 1; i <= m_size; i++)
+        {
+            m_tree[i] = T::calc(m_tree[i], elems[i - 1]);
+
+            std::uint64_t parent = i + (i & (~i + 1));
+            if (parent <= m_size)
+            {
+                m_tree[parent] = T::calc(m_tree[parent], m_tree[i]);
+            }
+        }
+    }
+
+    T query(std::uint64_t l, std::uint64_t r) const
+    {
+        return T::calc(this->queryPref(r + 1), T::calcInverse(this->queryPref(l)));
+    }
+
+    void update(std::uint64_t pos, const T& val)
+    {
+        this->updateBy(pos, T::calc(val, T::calcInverse(this->getElem(pos))));
+    }
+
+    void updateBy(std::uint64_t pos, const T& val)
+    {
+        for (std::uint64_t i = pos + 1; i <= m_size; i += i & (~i + 1))
+        {
+            m_tree[i] = T::calc(m_tree[i], val);
+        }
+    }
+
+    T getElem(std::uint64_t pos) const
+    {
+        return this->query(pos, pos);
+    }
+
+    template <typename Func>
+    std::uint64_t lowerBound(Func func) const
+    {
+        std::uint64_t step = 1;
+        while ((step << 1) <= m_size)
+        {
+            step <<= 1;
+        }
+
+        std::uint64_t pos = 0;
+        T cumulativePref{};
+
+        for (; step; step >>= 1)
+        {
+            if (pos + step > m_size)
+            {
+                continue;
+            }
+
+            T currVal = T::calc(cumulativePref, m_tree[pos + step]);
+            if (func(currVal))
+            {
+                pos += step;
+                cumulativePref = currVal;
+            }
+        }
+
+        return pos;
+    }
+
+    std::uint64_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    T queryPref(std::uint64_t count) const
+    {
+        T res{};
+        for (std::uint64_t i = count; i > 0; i -= i & (~i + 1))
+        {
+            res = T::calc(res, m_tree[i]);
+        }
+
+        return res;
+    }
+
+    std::uint64_t m_size;
+    std::vector<T> m_tree;
+};
+
+template <typename T>
+class RangeFenwickTree
+{
+public:
+    RangeFenwickTree(std::uint64_t size) :
+        m_size{ size },
+        m_tree(size + 1, { T{}, T{} })
+    {
+    }
+
+    RangeFenwickTree(const std::vector<T>& elems) :
+        m_size{ elems.size() },
+        m_tree(elems.size() + 1, { T{}, T{} })
+    {
+        for (std::uint64_t i = 1; i <= m_size; i++)
+        {
+            T diff = i > 1 ? T::calc(elems[i - 1], T::calcInverse(elems[i - 2])) : elems[i - 1];
+
+            m_tree[i].first = T::calc(m_tree[i].first, diff);
+            m_tree[i].second = T::calc(m_tree[i].second, T::calcMany(diff, i - 1));
+
+            std::uint64_t parent = i + (i & (~i + 1));
+            if (parent <= m_size)
+            {
+                m_tree[parent].first = T::calc(m_tree[parent].first, m_tree[i].first);
+                m_tree[parent].second = T::calc(m_tree[parent].second, m_tree[i].second);
+            }
+        }
+    }
+
+    T query(std::uint64_t l, std::uint64_t r) const
+    {
+        return T::calc(this->queryPref(r + 1), T::calcInverse(this->queryPref(l)));
+    }
+
+    void updateBy(std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        T inverseVal = T::calcInverse(val);
+
+        this->updatePoint(l + 1, val, T::calcMany(val, l));
+        this->updatePoint(r + 2, inverseVal, T::calcMany(inverseVal, r + 1));
+    }
+
+    T getElem(std::uint64_t pos) const
+    {
+        return this->query(pos, pos);
+    }
+
+    std::uint64_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    void updatePoint(std::uint64_t pos, const T& val, const T& weightedVal)
+    {
+        for (std::uint64_t i = pos; i <= m_size; i += i & (~i + 1))
+        {
+            m_tree[i].first = T::calc(m_tree[i].first, val);
+            m_tree[i].second = T::calc(m_tree[i].second, weightedVal);
+        }
+    }
+
+    T queryPref(std::uint64_t count) const
+    {
+        T res{};
+        T weightedRes{};
+        for (std::uint64_t i = count; i > 0; i -= i & (~i + 1))
+        {
+            res = T::calc(res, m_tree[i].first);
+            weightedRes = T::calc(weightedRes, m_tree[i].second);
+        }
+
+        return T::calc(T::calcMany(res, count), T::calcInverse(weightedRes));
+    }
+
+    std::uint64_t m_size;
+    std::vector<std::pair<T, T>> m_tree;
+};
+
+template <typename T>
+class FenwickTree2d
+{
+public:
+    FenwickTree2d(std::uint64_t sizeI, std::uint64_t sizeJ) :
+        m_sizeI{ sizeI },
+        m_sizeJ{ sizeJ },
+        m_tree((sizeI + 1) * (sizeJ + 1), T{})
+    {
+    }
+
+    FenwickTree2d(const std::vector<std::vector<T>>& elems) :
+        m_sizeI{ elems.size() },
+        m_sizeJ{ elems.empty() ? 0 : elems[0].size() },
+        m_tree((m_sizeI + 1) * (m_sizeJ + 1), T{})
+    {
+        for (std::uint64_t i = 1; i <= m_sizeI; i++)
+        {
+            for (std::uint64_t j = 1; j <= m_sizeJ; j++)
+            {
+                m_tree[i * (m_sizeJ + 1) + j] = T::calc(m_tree[i * (m_sizeJ + 1) + j], elems[i - 1][j - 1]);
+
+                std::uint64_t parentJ = j + (j & (~j + 1));
+                if (parentJ <= m_sizeJ)
+                {
+                    m_tree[i * (m_sizeJ + 1) + parentJ] = T::calc(m_tree[i * (m_sizeJ + 1) + parentJ], m_tree[i * (m_sizeJ + 1) + j]);
+                }
+            }
+        }
+        for (std::uint64_t i = 1; i <= m_sizeI; i++)
+        {
+            std::uint64_t parentI = i + (i & (~i + 1));
+            if (parentI > m_sizeI)
+            {
+                continue;
+            }
+            for (std::uint64_t j = 1; j <= m_sizeJ; j++)
+            {
+                m_tree[parentI * (m_sizeJ + 1) + j] = T::calc(m_tree[parentI * (m_sizeJ + 1) + j], m_tree[i * (m_sizeJ + 1) + j]);
+            }
+        }
+    }
+
+    T query(std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
+    {
+        return T::calc(
+            T::calc(this->queryPref(rI + 1, rJ + 1), this->queryPref(lI, lJ)),
+            T::calcInverse(T::calc(this->queryPref(lI, rJ + 1), this->queryPref(rI + 1, lJ)))
+        );
+    }
+
+    void update(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        this->updateBy(posI, posJ, T::calc(val, T::calcInverse(this->getElem(posI, posJ))));
+    }
+
+    void updateBy(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        for (std::uint64_t i = posI + 1; i <= m_sizeI; i += i & (~i + 1))
+        {
+            for (std::uint64_t j = posJ + 1; j <= m_sizeJ; j += j & (~j + 1))
+            {
+                m_tree[i * (m_sizeJ + 1) + j] = T::calc(m_tree[i * (m_sizeJ + 1) + j], val);
+            }
+        }
+    }
+
+    T getElem(std::uint64_t posI, std::uint64_t posJ) const
+    {
+        return this->query(posI, posI, posJ, posJ);
+    }
+
+private:
+    T queryPref(std::uint64_t countI, std::uint64_t countJ) const
+    {
+        T res{};
+        for (std::uint64_t i = countI; i > 0; i -= i & (~i + 1))
+        {
+            for (std::uint64_t j = countJ; j > 0; j -= j & (~j + 1))
+            {
+                res = T::calc(res, m_tree[i * (m_sizeJ + 1) + j]);
+            }
+        }
+
+        return res;
+    }
+
+    std::uint64_t m_sizeI;
+    std::uint64_t m_sizeJ;
+    std::vector<T> m_tree;
+};
+
+struct Sum
+{
+    std::int64_t val = 0;
+
+    static Sum calc(const Sum& left, const Sum& right)
+    {
+        return Sum{ left.val + right.val };
+    }
+
+    static Sum calcMany(const Sum& sum, std::uint64_t count)
+    {
+        return Sum{ sum.val * (std::int64_t)count };
+    }
+
+    static Sum calcInverse(const Sum& sum)
+    {
+        return Sum{ -sum.val };
+    }
+};
+
+struct Xor
+{
+    std::uint64_t val = 0;
+
+    static Xor calc(const Xor& left, const Xor& right)
+    {
+        return Xor{ left.val ^ right.val };
+    }
+
+    static Xor calcMany(const Xor& xr, std::uint64_t count)
+    {
+        return Xor{ count & 1 ? xr.val : 0 };
+    }
+
+    static Xor calcInverse(const Xor& xr)
+    {
+        return Xor{ xr.val };
+    }
+};
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <atomic>
+
+#include "NodePool.h"
 
 template <typename T>
 class ImplicitTreap
@@ -12,35 +15,52 @@ class ImplicitTreap
 public:
     ImplicitTreap() = default;
 
-    ImplicitTreap(const ImplicitTreap& implicitTreap) :
-        m_root{ implicitTreap.m_root ? new Node(*implicitTreap.m_root) : nullptr }
+    explicit ImplicitTreap(std::uint64_t seed) :
+        m_seed{ seed }
+    {
+    }
+
+    ImplicitTreap(const ImplicitTreap& implicitTreap)
     {
+        if (implicitTreap.m_root)
+        {
+            m_root = this->importNodes(*implicitTreap.m_pool, implicitTreap.m_root);
+        }
     }
 
     ImplicitTreap& operator=(const ImplicitTreap& implicitTreap)
     {
         if (this != &implicitTreap)
         {
-            delete m_root;
-            m_root = implicitTreap.m_root ? new Node(*implicitTreap.m_root) : nullptr;
+            this->clear();
+
+            if (implicitTreap.m_root)
+            {
+                m_root = this->importNodes(*implicitTreap.m_pool, implicitTreap.m_root);
+            }
         }
 
         return *this;
     }
 
     ImplicitTreap(ImplicitTreap&& implicitTreap) :
-        m_root{ implicitTreap.m_root }
+        m_pool{ std::move(implicitTreap.m_pool) },
+        m_root{ implicitTreap.m_root },
+        m_seed{ implicitTreap.m_seed }
     {
-        implicitTreap.m_root = nullptr;
+        implicitTreap.m_root = 0;
     }
 
     ImplicitTreap& operator=(ImplicitTreap&& implicitTreap)
     {
         if (this != &implicitTreap)
         {
-            delete m_root;
+            this->clear();
+
+            m_pool = std::move(implicitTreap.m_pool);
             m_root = implicitTreap.m_root;
-            implicitTreap.m_root = nullptr;
+            m_seed = implicitTreap.m_seed;
+            implicitTreap.m_root = 0;
         }
 
         return *this;
@@ -48,6 +68,8 @@ public:
 
     ImplicitTreap(const std::vector<T>& arr)
     {
+        this->getPool().reserve(arr.size() + 2);
+
         for (std::uint64_t i = 0; i < arr.size(); i++)
         {
             this->insert(i, arr[i]);
@@ -56,13 +78,16 @@ public:
 
     ImplicitTreap split(std::uint64_t pos)
     {
-        m_root = this->insert(m_root, 0, pos, new Node{});
+        m_root = this->insert(m_root, 0, pos, this->allocateNode(Node{ T{}, std::numeric_limits<std::uint64_t>::max(), 1 }));
+
+        NodePool<Node>& pool = *m_pool;
 
-        ImplicitTreap res{};
-        res.m_root = m_root->right;
+        ImplicitTreap res{ this->getPriority() };
+        res.m_pool = m_pool;
+        res.m_root = pool[m_root].rChild;
 
-        m_root->right = nullptr;
-        m_root->count = (m_root->left ? m_root->left->count : 0) + 1;
+        pool[m_root].rChild = 0;
+        pool[m_root].count = pool[pool[m_root].lChild].count + 1;
 
         this->erase(pos);
 
@@ -71,21 +96,39 @@ public:
 
     void merge(ImplicitTreap&& implicitTreap)
     {
-        Node* tempRoot = new Node{};
-        tempRoot->left = m_root;
-        tempRoot->right = implicitTreap.m_root;
-        tempRoot->count = (tempRoot->left ? tempRoot->left->count : 0) + (tempRoot->right ? tempRoot->right->count : 0) + 1;
+        std::uint32_t otherRoot = implicitTreap.m_root;
+        if (otherRoot && implicitTreap.m_pool != m_pool)
+        {
+            if (this->size() < implicitTreap.size())
+            {
+                std::uint32_t root = m_root ? implicitTreap.importNodes(*m_pool, m_root) : 0;
+
+                this->clear();
+                m_pool = implicitTreap.m_pool;
+                m_root = root;
+            }
+            else
+            {
+                otherRoot = this->importNodes(*implicitTreap.m_pool, otherRoot);
+                implicitTreap.clear();
+            }
+        }
+
+        NodePool<Node>& pool = this->getPool();
+
+        std::uint32_t tempRoot = this->allocateNode(Node{ T{}, std::numeric_limits<std::uint64_t>::max(), 1, m_root, otherRoot });
+        pool[tempRoot].count = pool[m_root].count + pool[otherRoot].count + 1;
 
         std::uint64_t pos = this->size();
         m_root = tempRoot;
         this->erase(pos);
 
-        implicitTreap.m_root = nullptr;
+        implicitTreap.m_root = 0;
     }
 
     void insert(std::uint64_t pos, const T& val)
     {
-        m_root = this->insert(m_root, 0, pos, new Node(val));
+        m_root = this->insert(m_root, 0, pos, this->allocateNode(Node{ val, this->getPriority(), 1 }));
     }
 
     void erase(std::uint64_t pos)
@@ -95,7 +138,7 @@ public:
             return;
         }
 
-        m_root = this->erase(m_root, std::min(pos, m_root->count - 1));
+        m_root = this->erase(m_root, std::min(pos, (*m_pool)[m_root].count - 1));
     }
 
     std::vector<T> getRange(std::uint64_t l, std::uint64_t r)
@@ -112,7 +155,7 @@ public:
 
     T get(std::uint64_t pos) const
     {
-        return pos < this->size() ? this->get(m_root, pos)->val : T{};
+        return pos < this->size() ? (*m_pool)[this->get(m_root, pos)].val : T{};
     }
 
     void update(std::uint64_t pos, const T& val)
@@ -127,7 +170,7 @@ public:
     {
         ImplicitTreap queryRange = this->eraseRange(l, r);
 
-        T res = queryRange.m_root->val;
+        T res = (*m_pool)[queryRange.m_root].val;
 
         this->insertRange(l, std::move(queryRange));
 
@@ -152,125 +195,210 @@ public:
         this->merge(std::move(endPart));
     }
 
+    std::uint64_t getDepth() const
+    {
+        if (!m_root)
+        {
+            return 0;
+        }
+
+        const NodePool<Node>& pool = *m_pool;
+
+        std::uint64_t depth = 0;
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{ { m_root, 1 } };
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            depth = std::max(depth, curr.second);
+
+            if (pool[curr.first].lChild)
+            {
+                stack.push_back({ pool[curr.first].lChild, curr.second + 1 });
+            }
+            if (pool[curr.first].rChild)
+            {
+                stack.push_back({ pool[curr.first].rChild, curr.second + 1 });
+            }
+        }
+
+        return depth;
+    }
+
     std::uint64_t size() const
     {
-        return m_root ? m_root->count : (std::uint64_t)0;
+        return m_root ? (*m_pool)[m_root].count : (std::uint64_t)0;
     }
 
     ~ImplicitTreap()
     {
-        if (m_root)
-        {
-            delete m_root;
-        }
+        this->clear();
     }
 
 private:
-    class Node
+    struct Node
     {
-    public:
-        Node() :
-            val{},
-            priority{ std::numeric_limits<std::uint64_t>::max() }
-        {
-        }
+        T val{};
+        std::uint64_t priority = 0;
+        std::uint64_t count = 0;
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+    };
 
-        Node(const T& nodeVal) :
-            val{ nodeVal },
-            priority{ (std::uint64_t)rand() }
+    NodePool<Node>& getPool()
+    {
+        if (!m_pool)
         {
+            m_pool = std::make_shared<NodePool<Node>>();
         }
 
-        Node(const Node& node) :
-            val{ node.val },
-            priority{ node.priority },
-            count{ node.count },
-            left{ node.left ? new Node(*node.left) : nullptr },
-            right{ node.right ? new Node(*node.right) : nullptr }
-        {
-        }
+        return *m_pool;
+    }
 
-        ~Node()
+    std::uint32_t allocateNode(const Node& node)
+    {
+        NodePool<Node>& pool = this->getPool();
+
+        std::uint32_t newNode = pool.allocate();
+        pool[newNode] = node;
+
+        return newNode;
+    }
+
+    void deallocateNode(std::uint32_t node)
+    {
+        NodePool<Node>& pool = *m_pool;
+
+        pool[node].lChild = 0;
+        pool[node].rChild = 0;
+        pool.release(node);
+    }
+
+    std::uint32_t importNodes(const NodePool<Node>& otherPool, std::uint32_t otherRoot)
+    {
+        std::uint32_t root = this->allocateNode(otherPool[otherRoot]);
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack{ { otherRoot, root } };
+        while (!stack.empty())
         {
-            if (left)
+            std::pair<std::uint32_t, std::uint32_t> curr = stack.back();
+            stack.pop_back();
+
+            const Node& otherNode = otherPool[curr.first];
+            std::uint32_t lChild = otherNode.lChild ? this->allocateNode(otherPool[otherNode.lChild]) : 0;
+            std::uint32_t rChild = otherNode.rChild ? this->allocateNode(otherPool[otherNode.rChild]) : 0;
+
+            (*m_pool)[curr.second].lChild = lChild;
+            (*m_pool)[curr.second].rChild = rChild;
+
+            if (lChild)
             {
-                delete left;
+                stack.push_back({ otherNode.lChild, lChild });
             }
-            if (right)
+            if (rChild)
             {
-                delete right;
+                stack.push_back({ otherNode.rChild, rChild });
             }
         }
 
-        T val;
-        std::uint64_t priority;
-        std::uint64_t count = 1;
-        Node* left = nullptr;
-        Node* right = nullptr;
-    };
+        return root;
+    }
 
-    Node* rightRotate(Node* y)
+    void clear()
     {
-        Node* x = y->left;
-        Node* t1 = x->left;
-        Node* t2 = x->right;
-        Node* t3 = y->right;
+        if (m_root && m_pool.use_count() > 1)
+        {
+            m_pool->release(m_root);
+        }
 
-        x->right = y;
-        y->left = t2;
+        m_pool.reset();
+        m_root = 0;
+    }
 
-        y->val = T::calcLeft(T::calcRight(t2 ? t2->val : T{}, T(y->val.key)), t3 ? t3->val : T{});
-        y->count = (t2 ? t2->count : 0) + (t3 ? t3->count : 0) + 1;
+    static std::uint64_t getDefaultSeed()
+    {
+        static std::atomic<std::uint64_t> instancesCount{ 0 };
 
-        x->val = T::calcLeft(T::calcRight(t1 ? t1->val : T{}, T(x->val.key)), y->val);
-        x->count = (t1 ? t1->count : 0) + y->count + 1;
+        return ImplicitTreap::mix(instancesCount.fetch_add(1, std::memory_order_relaxed));
+    }
 
-        return x;
+    static std::uint64_t mix(std::uint64_t val)
+    {
+        val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9;
+        val = (val ^ (val >> 27)) * 0x94D049BB133111EB;
+
+        return val ^ (val >> 31);
+    }
+
+    std::uint64_t getPriority()
+    {
+        m_seed += 0x9E3779B97F4A7C15;
+
+        return ImplicitTreap::mix(m_seed);
+    }
+
+    void recalc(std::uint32_t node)
+    {
+        NodePool<Node>& pool = *m_pool;
+        Node& currNode = pool[node];
+
+        currNode.val = T::calcLeft(T::calcRight(pool[currNode.lChild].val, T(currNode.val.key)), pool[currNode.rChild].val);
+        currNode.count = pool[currNode.lChild].count + pool[currNode.rChild].count + 1;
     }
 
-    Node* leftRotate(Node* x)
+    std::uint32_t rightRotate(std::uint32_t y)
     {
-        Node* y = x->right;
-        Node* t1 = x->left;
-        Node* t2 = y->left;
-        Node* t3 = y->right;
+        NodePool<Node>& pool = *m_pool;
+        std::uint32_t x = pool[y].lChild;
 
-        y->left = x;
-        x->right = t2;
+        pool[y].lChild = pool[x].rChild;
+        pool[x].rChild = y;
 
-        x->val = T::calcLeft(T::calcRight(t1 ? t1->val : T{}, T(x->val.key)), t2 ? t2->val : T{});
-        x->count = (t1 ? t1->count : 0) + (t2 ? t2->count : 0) + 1;
+        this->recalc(y);
+        this->recalc(x);
 
-        y->val = T::calcLeft(T::calcRight(x->val, T(y->val.key)), t3 ? t3->val : T{});
-        y->count = x->count + (t3 ? t3->count : 0) + 1;
+        return x;
+    }
+
+    std::uint32_t leftRotate(std::uint32_t x)
+    {
+        NodePool<Node>& pool = *m_pool;
+        std::uint32_t y = pool[x].rChild;
+
+        pool[x].rChild = pool[y].lChild;
+        pool[y].lChild = x;
+
+        this->recalc(x);
+        this->recalc(y);
 
         return y;
     }
 
-    Node* insert(Node* node, std::uint64_t k, std::uint64_t pos, Node* val)
+    std::uint32_t insert(std::uint32_t node, std::uint64_t k, std::uint64_t pos, std::uint32_t val)
     {
+        NodePool<Node>& pool = *m_pool;
+
         if (!node)
         {
             node = val;
         }
-        else if (pos <= k + (node->left ? node->left->count : 0))
+        else if (pos <= k + pool[pool[node].lChild].count)
         {
-            node->left = this->insert(node->left, k, pos, val);
-            node->count++;
-            node->val = T::calcRight(val->val, node->val);
+            pool[node].lChild = this->insert(pool[node].lChild, k, pos, val);
+            this->recalc(node);
 
-            if (node->left->priority > node->priority)
+            if (pool[pool[node].lChild].priority > pool[node].priority)
             {
                 node = this->rightRotate(node);
             }
         }
         else
         {
-            node->right = this->insert(node->right, k + (node->left ? node->left->count : 0) + 1, pos, val);
-            node->count++;
-            node->val = T::calcLeft(node->val, val->val);
+            pool[node].rChild = this->insert(pool[node].rChild, k + pool[pool[node].lChild].count + 1, pos, val);
+            this->recalc(node);
 
-            if (node->right->priority > node->priority)
+            if (pool[pool[node].rChild].priority > pool[node].priority)
             {
                 node = this->leftRotate(node);
             }
@@ -279,106 +407,101 @@ private:
         return node;
     }
 
-    Node* erase(Node* node, std::uint64_t pos)
+    std::uint32_t erase(std::uint32_t node, std::uint64_t pos)
     {
-        if (pos < (node->left ? node->left->count : 0))
-        {
-            node->left = this->erase(node->left, pos);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T(node->val.key)), node->right ? node->right->val : T{});
+        NodePool<Node>& pool = *m_pool;
 
-            return node;
-        }
-        if (pos > (node->left ? node->left->count : 0))
+        if (pos < pool[pool[node].lChild].count)
         {
-            node->right = this->erase(node->right, pos - (node->left ? node->left->count : 0) - 1);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T(node->val.key)), node->right ? node->right->val : T{});
+            pool[node].lChild = this->erase(pool[node].lChild, pos);
+            this->recalc(node);
 
             return node;
         }
-        if (!node->left)
+        if (pos > pool[pool[node].lChild].count)
         {
-            Node* temp = node->right;
-            node->right = nullptr;
-            delete node;
+            pool[node].rChild = this->erase(pool[node].rChild, pos - pool[pool[node].lChild].count - 1);
+            this->recalc(node);
 
-            return temp;
+            return node;
         }
-        if (!node->right)
+        if (!pool[node].lChild || !pool[node].rChild)
         {
-            Node* temp = node->left;
-            node->left = nullptr;
-            delete node;
+            std::uint32_t temp = pool[node].lChild ? pool[node].lChild : pool[node].rChild;
+            this->deallocateNode(node);
 
             return temp;
         }
-        if (node->left->priority < node->right->priority)
+        if (pool[pool[node].lChild].priority < pool[pool[node].rChild].priority)
         {
             node = this->leftRotate(node);
 
-            node->left = this->erase(node->left, pos);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T(node->val.key)), node->right ? node->right->val : T{});
+            pool[node].lChild = this->erase(pool[node].lChild, pos);
+            this->recalc(node);
 
             return node;
         }
 
         node = this->rightRotate(node);
 
-        node->right = this->erase(node->right, pos - (node->left ? node->left->count : 0) - 1);
-        node->count--;
-        node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T(node->val.key)), node->right ? node->right->val : T{});
+        pool[node].rChild = this->erase(pool[node].rChild, pos - pool[pool[node].lChild].count - 1);
+        this->recalc(node);
 
         return node;
     }
 
-    void getRange(Node* node, std::vector<T>& res) const
+    void getRange(std::uint32_t node, std::vector<T>& res) const
     {
         if (!node)
         {
             return;
         }
 
-        this->getRange(node->left, res);
-        res.push_back(node->val);
-        this->getRange(node->right, res);
+        this->getRange((*m_pool)[node].lChild, res);
+        res.push_back((*m_pool)[node].val);
+        this->getRange((*m_pool)[node].rChild, res);
     }
 
-    Node* get(Node* node, std::uint64_t pos) const
+    std::uint32_t get(std::uint32_t node, std::uint64_t pos) const
     {
-        if (node->left && pos < node->left->count)
+        const NodePool<Node>& pool = *m_pool;
+
+        if (pos < pool[pool[node].lChild].count)
         {
-            return this->get(node->left, pos);
+            return this->get(pool[node].lChild, pos);
         }
 
-        if (node->right && pos > (node->left ? node->left->count : 0))
+        if (pool[node].rChild && pos > pool[pool[node].lChild].count)
         {
-            return this->get(node->right, pos - (node->left ? node->left->count : 0) - 1);
+            return this->get(pool[node].rChild, pos - pool[pool[node].lChild].count - 1);
         }
 
         return node;
     }
 
-    void update(Node* node, std::uint64_t pos, const T& val)
+    void update(std::uint32_t node, std::uint64_t pos, const T& val)
     {
-        if (node->left && pos < node->left->count)
+        NodePool<Node>& pool = *m_pool;
+
+        if (pos < pool[pool[node].lChild].count)
         {
-            this->update(node->left, pos, val);
+            this->update(pool[node].lChild, pos, val);
         }
-        else if (node->right && pos > (node->left ? node->left->count : 0))
+        else if (pool[node].rChild && pos > pool[pool[node].lChild].count)
         {
-            this->update(node->right, pos - (node->left ? node->left->count : 0) - 1, val);
+            this->update(pool[node].rChild, pos - pool[pool[node].lChild].count - 1, val);
         }
         else
         {
-            node->val = val;
+            pool[node].val = val;
         }
 
-        node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T(node->val.key)), node->right ? node->right->val : T{});
+        this->recalc(node);
     }
 
-    Node* m_root = nullptr;
+    std::shared_ptr<NodePool<Node>> m_pool{};
+    std::uint32_t m_root = 0;
+    std::uint64_t m_seed = ImplicitTreap::getDefaultSeed();
 };
 
 struct Key
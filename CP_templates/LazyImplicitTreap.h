@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <atomic>
+
+#include "NodePool.h"
 
 template <typename T>
 class LazyImplicitTreap
@@ -12,35 +15,52 @@ class LazyImplicitTreap
 public:
     LazyImplicitTreap() = default;
 
-    LazyImplicitTreap(const LazyImplicitTreap& lazyImplicitTreap) :
-        m_root{ lazyImplicitTreap.m_root ? new Node(*lazyImplicitTreap.m_root) : nullptr }
+    explicit LazyImplicitTreap(std::uint64_t seed) :
+        m_seed{ seed }
+    {
+    }
+
+    LazyImplicitTreap(const LazyImplicitTreap& lazyImplicitTreap)
     {
+        if (lazyImplicitTreap.m_root)
+        {
+            m_root = this->importNodes(*lazyImplicitTreap.m_pool, lazyImplicitTreap.m_root);
+        }
     }
 
     LazyImplicitTreap& operator=(const LazyImplicitTreap& lazyImplicitTreap)
     {
         if (this != &lazyImplicitTreap)
         {
-            delete m_root;
-            m_root = lazyImplicitTreap.m_root ? new Node(*lazyImplicitTreap.m_root) : nullptr;
+            this->clear();
+
+            if (lazyImplicitTreap.m_root)
+            {
+                m_root = this->importNodes(*lazyImplicitTreap.m_pool, lazyImplicitTreap.m_root);
+            }
         }
 
         return *this;
     }
 
     LazyImplicitTreap(LazyImplicitTreap&& lazyImplicitTreap) :
-        m_root{ lazyImplicitTreap.m_root }
+        m_pool{ std::move(lazyImplicitTreap.m_pool) },
+        m_root{ lazyImplicitTreap.m_root },
+        m_seed{ lazyImplicitTreap.m_seed }
     {
-        lazyImplicitTreap.m_root = nullptr;
+        lazyImplicitTreap.m_root = 0;
     }
 
     LazyImplicitTreap& operator=(LazyImplicitTreap&& lazyImplicitTreap)
     {
         if (this != &lazyImplicitTreap)
         {
-            delete m_root;
+            this->clear();
+
+            m_pool = std::move(lazyImplicitTreap.m_pool);
             m_root = lazyImplicitTreap.m_root;
-            lazyImplicitTreap.m_root = nullptr;
+            m_seed = lazyImplicitTreap.m_seed;
+            lazyImplicitTreap.m_root = 0;
         }
 
         return *this;
@@ -48,6 +68,8 @@ public:
 
     LazyImplicitTreap(const std::vector<T>& arr)
     {
+        this->getPool().reserve(arr.size() + 2);
+
         for (std::uint64_t i = 0; i < arr.size(); i++)
         {
             this->insert(i, arr[i]);
@@ -56,15 +78,18 @@ public:
 
     LazyImplicitTreap split(std::uint64_t pos)
     {
-        m_root = this->insert(m_root, 0, pos, new Node{});
+        m_root = this->insert(m_root, 0, pos, this->allocateNode(LazyImplicitTreap::createNode(T{}, std::numeric_limits<std::uint64_t>::max())));
+
+        NodePool<Node>& pool = *m_pool;
 
-        this->propagate(m_root->left);
+        this->propagate(pool[m_root].lChild);
 
-        LazyImplicitTreap res{};
-        res.m_root = m_root->right;
+        LazyImplicitTreap res{ this->getPriority() };
+        res.m_pool = m_pool;
+        res.m_root = pool[m_root].rChild;
 
-        m_root->right = nullptr;
-        m_root->count = (m_root->left ? m_root->left->count : 0) + m_root->weight;
+        pool[m_root].rChild = 0;
+        pool[m_root].count = pool[pool[m_root].lChild].count + pool[m_root].weight;
 
         this->erase(pos);
 
@@ -73,24 +98,44 @@ public:
 
     void merge(LazyImplicitTreap&& lazyImplicitTreap)
     {
+        std::uint32_t otherRoot = lazyImplicitTreap.m_root;
+        if (otherRoot && lazyImplicitTreap.m_pool != m_pool)
+        {
+            if (this->size() < lazyImplicitTreap.size())
+            {
+                std::uint32_t root = m_root ? lazyImplicitTreap.importNodes(*m_pool, m_root) : 0;
+
+                this->clear();
+                m_pool = lazyImplicitTreap.m_pool;
+                m_root = root;
+            }
+            else
+            {
+                otherRoot = this->importNodes(*lazyImplicitTreap.m_pool, otherRoot);
+                lazyImplicitTreap.clear();
+            }
+        }
+
+        NodePool<Node>& pool = this->getPool();
+
         this->propagate(m_root);
-        lazyImplicitTreap.propagate(lazyImplicitTreap.m_root);
+        this->propagate(otherRoot);
 
-        Node* tempRoot = new Node{};
-        tempRoot->left = m_root;
-        tempRoot->right = lazyImplicitTreap.m_root;
-        tempRoot->count = (tempRoot->left ? tempRoot->left->count : 0) + (tempRoot->right ? tempRoot->right->count : 0) + tempRoot->weight;
+        std::uint32_t tempRoot = this->allocateNode(LazyImplicitTreap::createNode(T{}, std::numeric_limits<std::uint64_t>::max()));
+        pool[tempRoot].lChild = m_root;
+        pool[tempRoot].rChild = otherRoot;
+        pool[tempRoot].count = pool[m_root].count + pool[otherRoot].count + pool[tempRoot].weight;
 
         std::uint64_t pos = this->size();
         m_root = tempRoot;
         this->erase(pos);
 
-        lazyImplicitTreap.m_root = nullptr;
+        lazyImplicitTreap.m_root = 0;
     }
 
     void insert(std::uint64_t pos, const T& val)
     {
-        m_root = this->insert(m_root, 0, pos, new Node(val));
+        m_root = this->insert(m_root, 0, pos, this->allocateNode(LazyImplicitTreap::createNode(val, this->getPriority())));
     }
 
     void erase(std::uint64_t pos)
@@ -100,7 +145,7 @@ public:
             return;
         }
 
-        m_root = this->erase(m_root, std::min(pos, m_root->count - 1));
+        m_root = this->erase(m_root, std::min(pos, (*m_pool)[m_root].count - 1));
     }
 
     LazyImplicitTreap eraseRange(std::uint64_t l, std::uint64_t r)
@@ -135,15 +180,15 @@ public:
 
     T get(std::uint64_t pos)
     {
-        return pos < this->size() ? this->get(m_root, pos)->val : T{};
+        return pos < this->size() ? (*m_pool)[this->get(m_root, pos)].val : T{};
     }
 
     void updateRangeBy(std::uint64_t l, std::uint64_t r, const T& val)
     {
         LazyImplicitTreap replaceRange = this->eraseRange(l, r);
 
-        replaceRange.m_root->lazyType = 1;
-        replaceRange.m_root->lazy = val;
+        (*m_pool)[replaceRange.m_root].lazyType = 1;
+        (*m_pool)[replaceRange.m_root].lazy = val;
 
         this->insertRange(l, std::move(replaceRange));
     }
@@ -152,8 +197,8 @@ public:
     {
         LazyImplicitTreap replaceRange = this->eraseRange(l, r);
 
-        replaceRange.m_root->lazyType = 2;
-        replaceRange.m_root->lazy = val;
+        (*m_pool)[replaceRange.m_root].lazyType = 2;
+        (*m_pool)[replaceRange.m_root].lazy = val;
 
         this->insertRange(l, std::move(replaceRange));
     }
@@ -162,7 +207,7 @@ public:
     {
         LazyImplicitTreap reverseRange = this->eraseRange(l, r);
 
-        reverseRange.m_root->lazyReverse = !reverseRange.m_root->lazyReverse;
+        (*m_pool)[reverseRange.m_root].lazyReverse = !(*m_pool)[reverseRange.m_root].lazyReverse;
 
         this->insertRange(l, std::move(reverseRange));
     }
@@ -173,7 +218,7 @@ public:
 
         if (count)
         {
-            cloneRange.m_root->lazyClone = count;
+            (*m_pool)[cloneRange.m_root].lazyClone = count;
             this->insertRange(l, std::move(cloneRange));
         }
     }
@@ -182,13 +227,44 @@ public:
     {
         LazyImplicitTreap queryRange = this->eraseRange(l, r);
 
-        T res = queryRange.m_root->val;
+        T res = (*m_pool)[queryRange.m_root].val;
 
         this->insertRange(l, std::move(queryRange));
 
         return res;
     }
 
+    std::uint64_t getDepth() const
+    {
+        if (!m_root)
+        {
+            return 0;
+        }
+
+        const NodePool<Node>& pool = *m_pool;
+
+        std::uint64_t depth = 0;
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{ { m_root, 1 } };
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            depth = std::max(depth, curr.second);
+
+            if (pool[curr.first].lChild)
+            {
+                stack.push_back({ pool[curr.first].lChild, curr.second + 1 });
+            }
+            if (pool[curr.first].rChild)
+            {
+                stack.push_back({ pool[curr.first].rChild, curr.second + 1 });
+            }
+        }
+
+        return depth;
+    }
+
     std::uint64_t size()
     {
         if (!m_root)
@@ -198,328 +274,370 @@ public:
 
         this->propagate(m_root);
 
-        return m_root->count;
+        return (*m_pool)[m_root].count;
     }
 
     ~LazyImplicitTreap()
     {
-        if (m_root)
-        {
-            delete m_root;
-        }
+        this->clear();
     }
 
 private:
-    class Node
+    struct Node
     {
-    public:
-        Node() :
-            val{},
-            priority{ std::numeric_limits<std::uint64_t>::max() }
-        {
-        }
+        T val{};
+        T lazy{};
+        std::uint8_t lazyType = 0;
+        bool lazyReverse = false;
+        std::uint64_t lazyClone = 1;
+        std::uint64_t priority = 0;
+        std::uint64_t count = 0;
+        std::uint64_t weight = 0;
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+    };
 
-        Node(const T& nodeVal) :
-            val{ nodeVal },
-            priority{ (std::uint64_t)std::rand() }
-        {
-        }
+    static Node createNode(const T& val, std::uint64_t priority)
+    {
+        Node node{};
+        node.val = val;
+        node.priority = priority;
+        node.count = 1;
+        node.weight = 1;
 
-        Node(const Node& node) :
-            val{ node.val },
-            lazy{ node.lazy },
-            lazyType{ node.lazyType },
-            lazyReverse{ node.lazyReverse },
-            lazyClone{ node.lazyClone },
-            priority{ node.priority },
-            count{ node.count },
-            weight{ node.weight },
-            left{ node.left ? new Node(*node.left) : nullptr },
-            right{ node.right ? new Node(*node.right) : nullptr }
+        return node;
+    }
+
+    NodePool<Node>& getPool()
+    {
+        if (!m_pool)
         {
+            m_pool = std::make_shared<NodePool<Node>>();
         }
 
-        ~Node()
+        return *m_pool;
+    }
+
+    std::uint32_t allocateNode(const Node& node)
+    {
+        NodePool<Node>& pool = this->getPool();
+
+        std::uint32_t newNode = pool.allocate();
+        pool[newNode] = node;
+
+        return newNode;
+    }
+
+    void deallocateNode(std::uint32_t node)
+    {
+        NodePool<Node>& pool = *m_pool;
+
+        pool[node].lChild = 0;
+        pool[node].rChild = 0;
+        pool.release(node);
+    }
+
+    std::uint32_t importNodes(const NodePool<Node>& otherPool, std::uint32_t otherRoot)
+    {
+        std::uint32_t root = this->allocateNode(otherPool[otherRoot]);
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack{ { otherRoot, root } };
+        while (!stack.empty())
         {
-            if (left)
+            std::pair<std::uint32_t, std::uint32_t> curr = stack.back();
+            stack.pop_back();
+
+            const Node& otherNode = otherPool[curr.first];
+            std::uint32_t lChild = otherNode.lChild ? this->allocateNode(otherPool[otherNode.lChild]) : 0;
+            std::uint32_t rChild = otherNode.rChild ? this->allocateNode(otherPool[otherNode.rChild]) : 0;
+
+            (*m_pool)[curr.second].lChild = lChild;
+            (*m_pool)[curr.second].rChild = rChild;
+
+            if (lChild)
             {
-                delete left;
+                stack.push_back({ otherNode.lChild, lChild });
             }
-            if (right)
+            if (rChild)
             {
-                delete right;
+                stack.push_back({ otherNode.rChild, rChild });
             }
         }
 
-        T val;
-        T lazy{};
-        std::uint8_t lazyType = 0;
-        bool lazyReverse = false;
-        std::uint64_t lazyClone = 1;
-        std::uint64_t priority;
-        std::uint64_t count = 1;
-        std::uint64_t weight = 1;
-        Node* left = nullptr;
-        Node* right = nullptr;
-    };
+        return root;
+    }
+
+    void clear()
+    {
+        if (m_root && m_pool.use_count() > 1)
+        {
+            m_pool->release(m_root);
+        }
+
+        m_pool.reset();
+        m_root = 0;
+    }
+
+    static std::uint64_t getDefaultSeed()
+    {
+        static std::atomic<std::uint64_t> instancesCount{ 0 };
+
+        return LazyImplicitTreap::mix(instancesCount.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    static std::uint64_t mix(std::uint64_t val)
+    {
+        val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9;
+        val = (val ^ (val >> 27)) * 0x94D049BB133111EB;
+
+        return val ^ (val >> 31);
+    }
 
-    void propagate(Node* node)
+    std::uint64_t getPriority()
+    {
+        m_seed += 0x9E3779B97F4A7C15;
+
+        return LazyImplicitTreap::mix(m_seed);
+    }
+
+    void recalc(std::uint32_t node)
+    {
+        NodePool<Node>& pool = *m_pool;
+        Node& currNode = pool[node];
+
+        currNode.val = T::calcLeft(T::calcRight(pool[currNode.lChild].val, T::calcMany(currNode.val, currNode.weight)), pool[currNode.rChild].val);
+        currNode.count = pool[currNode.lChild].count + pool[currNode.rChild].count + currNode.weight;
+    }
+
+    void propagate(std::uint32_t node)
     {
         if (!node)
         {
             return;
         }
 
-        if (node->lazyReverse)
+        NodePool<Node>& pool = *m_pool;
+        Node& currNode = pool[node];
+
+        if (currNode.lazyReverse)
         {
-            if (node->left)
+            if (currNode.lChild)
             {
-                node->left->lazyReverse = !node->left->lazyReverse;
+                pool[currNode.lChild].lazyReverse = !pool[currNode.lChild].lazyReverse;
             }
-            if (node->right)
+            if (currNode.rChild)
             {
-                node->right->lazyReverse = !node->right->lazyReverse;
+                pool[currNode.rChild].lazyReverse = !pool[currNode.rChild].lazyReverse;
             }
 
-            std::swap(node->left, node->right);
-            node->val = T::reverse(node->val);
-            node->lazyReverse = false;
+            std::swap(currNode.lChild, currNode.rChild);
+            currNode.val = T::reverse(currNode.val);
+            currNode.lazyReverse = false;
         }
 
-        if (node->lazyClone != 1)
+        if (currNode.lazyClone != 1)
         {
-            node->count *= node->lazyClone;
-            node->weight *= node->lazyClone;
-            node->val = T::calcManyVal(node->val, node->lazyClone);
+            currNode.count *= currNode.lazyClone;
+            currNode.weight *= currNode.lazyClone;
+            currNode.val = T::calcManyVal(currNode.val, currNode.lazyClone);
 
-            if (node->left)
+            if (currNode.lChild)
             {
-                node->left->lazyClone *= node->lazyClone;
+                pool[currNode.lChild].lazyClone *= currNode.lazyClone;
             }
-            if (node->right)
+            if (currNode.rChild)
             {
-                node->right->lazyClone *= node->lazyClone;
+                pool[currNode.rChild].lazyClone *= currNode.lazyClone;
             }
 
-            node->lazyClone = 1;
+            currNode.lazyClone = 1;
         }
 
-        if (!node->lazyType)
+        if (!currNode.lazyType)
         {
             return;
         }
 
-        if (node->lazyType == 1)
+        if (currNode.lazyType == 1)
         {
-            node->val = T::calcLazy(node->val, T::calcMany(node->lazy, node->count));
+            currNode.val = T::calcLazy(currNode.val, T::calcMany(currNode.lazy, currNode.count));
         }
         else
         {
-            node->val = T::calcMany(node->lazy, node->count);
+            currNode.val = T::calcMany(currNode.lazy, currNode.count);
         }
 
-        if (node->left)
+        for (std::uint32_t child : { currNode.lChild, currNode.rChild })
         {
-            if (node->lazyType == 1 && node->left->lazyType)
-            {
-                node->left->lazy = T::calcLazy(node->left->lazy, node->lazy);
-            }
-            else
+            if (!child)
             {
-                node->left->lazy = node->lazy;
-                node->left->lazyType = node->lazyType;
+                continue;
             }
-        }
 
-        if (node->right)
-        {
-            if (node->lazyType == 1 && node->right->lazyType)
+            if (currNode.lazyType == 1 && pool[child].lazyType)
             {
-                node->right->lazy = T::calcLazy(node->right->lazy, node->lazy);
+                pool[child].lazy = T::calcLazy(pool[child].lazy, currNode.lazy);
             }
             else
             {
-                node->right->lazy = node->lazy;
-                node->right->lazyType = node->lazyType;
+                pool[child].lazy = currNode.lazy;
+                pool[child].lazyType = currNode.lazyType;
             }
         }
 
-        node->lazyType = 0;
+        currNode.lazyType = 0;
     }
 
-    Node* rightRotate(Node* y)
+    std::uint32_t rightRotate(std::uint32_t y)
     {
-        this->propagate(y);
-        this->propagate(y->left);
-        this->propagate(y->left->left);
-        this->propagate(y->left->right);
-        this->propagate(y->right);
+        NodePool<Node>& pool = *m_pool;
 
-        Node* x = y->left;
-        Node* t1 = x->left;
-        Node* t2 = x->right;
-        Node* t3 = y->right;
+        this->propagate(y);
 
-        x->right = y;
-        y->left = t2;
+        std::uint32_t x = pool[y].lChild;
+        this->propagate(x);
+        this->propagate(pool[x].lChild);
+        this->propagate(pool[x].rChild);
+        this->propagate(pool[y].rChild);
 
-        y->val = T::calcLeft(T::calcRight(t2 ? t2->val : T{}, T::calcMany(y->val, y->weight)), t3 ? t3->val : T{});
-        y->count = (t2 ? t2->count : 0) + (t3 ? t3->count : 0) + y->weight;
+        pool[y].lChild = pool[x].rChild;
+        pool[x].rChild = y;
 
-        x->val = T::calcLeft(T::calcRight(t1 ? t1->val : T{}, T::calcMany(x->val, x->weight)), y->val);
-        x->count = (t1 ? t1->count : 0) + y->count + x->weight;
+        this->recalc(y);
+        this->recalc(x);
 
         return x;
     }
 
-    Node* leftRotate(Node* x)
+    std::uint32_t leftRotate(std::uint32_t x)
     {
-        this->propagate(x);
-        this->propagate(x->right);
-        this->propagate(x->left);
-        this->propagate(x->right->left);
-        this->propagate(x->right->right);
+        NodePool<Node>& pool = *m_pool;
 
-        Node* y = x->right;
-        Node* t1 = x->left;
-        Node* t2 = y->left;
-        Node* t3 = y->right;
+        this->propagate(x);
 
-        y->left = x;
-        x->right = t2;
+        std::uint32_t y = pool[x].rChild;
+        this->propagate(y);
+        this->propagate(pool[x].lChild);
+        this->propagate(pool[y].lChild);
+        this->propagate(pool[y].rChild);
 
-        x->val = T::calcLeft(T::calcRight(t1 ? t1->val : T{}, T::calcMany(x->val, x->weight)), t2 ? t2->val : T{});
-        x->count = (t1 ? t1->count : 0) + (t2 ? t2->count : 0) + x->weight;
+        pool[x].rChild = pool[y].lChild;
+        pool[y].lChild = x;
 
-        y->val = T::calcLeft(T::calcRight(x->val, T::calcMany(y->val, y->weight)), t3 ? t3->val : T{});
-        y->count = x->count + (t3 ? t3->count : 0) + y->weight;
+        this->recalc(x);
+        this->recalc(y);
 
         return y;
     }
 
-    Node* insert(Node* node, std::uint64_t k, std::uint64_t pos, Node* val)
+    std::uint32_t insert(std::uint32_t node, std::uint64_t k, std::uint64_t pos, std::uint32_t val)
     {
-        this->propagate(node);
-
-        if (node)
-        {
-            this->propagate(node->left);
-            this->propagate(node->right);
-        }
+        NodePool<Node>& pool = *m_pool;
 
         if (!node)
         {
-            node = val;
-            this->propagate(node);
+            this->propagate(val);
+
+            return val;
         }
-        else if (pos <= k + (node->left ? node->left->count : 0))
+
+        this->propagate(node);
+        this->propagate(pool[node].lChild);
+        this->propagate(pool[node].rChild);
+
+        if (pos <= k + pool[pool[node].lChild].count)
         {
-            node->left = this->insert(node->left, k, pos, val);
-            node->count += val->weight;
-            node->val = T::calcRight(val->val, node->val);
+            pool[node].lChild = this->insert(pool[node].lChild, k, pos, val);
+            this->recalc(node);
 
-            if (node->left->priority > node->priority)
+            if (pool[pool[node].lChild].priority > pool[node].priority)
             {
                 node = this->rightRotate(node);
             }
         }
-        else if (pos >= k + (node->left ? node->left->count : 0) + node->weight)
+        else if (pos >= k + pool[pool[node].lChild].count + pool[node].weight)
         {
-            node->right = this->insert(node->right, k + (node->left ? node->left->count : 0) + node->weight, pos, val);
-            node->count += val->weight;
-            node->val = T::calcLeft(node->val, val->val);
+            pool[node].rChild = this->insert(pool[node].rChild, k + pool[pool[node].lChild].count + pool[node].weight, pos, val);
+            this->recalc(node);
 
-            if (node->right->priority > node->priority)
+            if (pool[pool[node].rChild].priority > pool[node].priority)
             {
                 node = this->leftRotate(node);
             }
         }
         else
         {
-            std::uint64_t rightCount = k + (node->left ? node->left->count : 0) + node->weight - pos;
-            node->count -= rightCount;
-            node->weight -= rightCount;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+            std::uint64_t rightCount = k + pool[pool[node].lChild].count + pool[node].weight - pos;
+            pool[node].weight -= rightCount;
+            this->recalc(node);
 
-            Node* insertNode = new Node(node->val);
-            insertNode->count = rightCount;
-            insertNode->weight = rightCount;
-            insertNode->val = T::calcMany(insertNode->val, insertNode->weight);
+            Node insertNode = LazyImplicitTreap::createNode(pool[node].val, this->getPriority());
+            insertNode.count = rightCount;
+            insertNode.weight = rightCount;
+            insertNode.val = T::calcMany(insertNode.val, insertNode.weight);
 
-            node = this->insert(node, k, pos, insertNode);
+            node = this->insert(node, k, pos, this->allocateNode(insertNode));
             node = this->insert(node, k, pos, val);
         }
 
         return node;
     }
 
-    Node* erase(Node* node, std::uint64_t pos)
+    std::uint32_t erase(std::uint32_t node, std::uint64_t pos)
     {
+        NodePool<Node>& pool = *m_pool;
+
         this->propagate(node);
-        this->propagate(node->left);
-        this->propagate(node->right);
+        this->propagate(pool[node].lChild);
+        this->propagate(pool[node].rChild);
 
-        if (pos < (node->left ? node->left->count : 0))
+        if (pos < pool[pool[node].lChild].count)
         {
-            node->left = this->erase(node->left, pos);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+            pool[node].lChild = this->erase(pool[node].lChild, pos);
+            this->recalc(node);
 
             return node;
         }
-        if (pos >= (node->left ? node->left->count : 0) + node->weight)
+        if (pos >= pool[pool[node].lChild].count + pool[node].weight)
         {
-            node->right = this->erase(node->right, pos - (node->left ? node->left->count : 0) - node->weight);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+            pool[node].rChild = this->erase(pool[node].rChild, pos - pool[pool[node].lChild].count - pool[node].weight);
+            this->recalc(node);
 
             return node;
         }
-        if (node->weight != 1)
+        if (pool[node].weight != 1)
         {
-            node->count--;
-            node->weight--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+            pool[node].weight--;
+            this->recalc(node);
 
             return node;
         }
-        if (!node->left)
+        if (!pool[node].lChild || !pool[node].rChild)
         {
-            Node* temp = node->right;
-            node->right = nullptr;
-            delete node;
+            std::uint32_t temp = pool[node].lChild ? pool[node].lChild : pool[node].rChild;
+            this->deallocateNode(node);
 
             return temp;
         }
-        if (!node->right)
-        {
-            Node* temp = node->left;
-            node->left = nullptr;
-            delete node;
-
-            return temp;
-        }
-        if (node->left->priority < node->right->priority)
+        if (pool[pool[node].lChild].priority < pool[pool[node].rChild].priority)
         {
             node = this->leftRotate(node);
 
-            node->left = this->erase(node->left, pos);
-            node->count--;
-            node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+            pool[node].lChild = this->erase(pool[node].lChild, pos);
+            this->recalc(node);
 
             return node;
         }
 
         node = this->rightRotate(node);
 
-        node->right = this->erase(node->right, pos - (node->left ? node->left->count : 0) - node->weight);
-        node->count--;
-        node->val = T::calcLeft(T::calcRight(node->left ? node->left->val : T{}, T::calcMany(node->val, node->weight)), node->right ? node->right->val : T{});
+        pool[node].rChild = this->erase(pool[node].rChild, pos - pool[pool[node].lChild].count - pool[node].weight);
+        this->recalc(node);
 
         return node;
     }
 
-    void getRange(Node* node, std::vector<T>& res)
+    void getRange(std::uint32_t node, std::vector<T>& res)
     {
         if (!node)
         {
@@ -528,30 +646,34 @@ private:
 
         this->propagate(node);
 
-        this->getRange(node->left, res);
-        res.insert(res.end(), node->weight, node->val);
-        this->getRange(node->right, res);
+        this->getRange((*m_pool)[node].lChild, res);
+        res.insert(res.end(), (*m_pool)[node].weight, (*m_pool)[node].val);
+        this->getRange((*m_pool)[node].rChild, res);
     }
 
-    Node* get(Node* node, std::uint64_t pos)
+    std::uint32_t get(std::uint32_t node, std::uint64_t pos)
     {
+        NodePool<Node>& pool = *m_pool;
+
         this->propagate(node);
-        this->propagate(node->left);
+        this->propagate(pool[node].lChild);
 
-        if (pos < (node->left ? node->left->count : 0))
+        if (pos < pool[pool[node].lChild].count)
         {
-            return this->get(node->left, pos);
+            return this->get(pool[node].lChild, pos);
         }
 
-        if (node->right && pos >= (node->left ? node->left->count : 0) + node->weight)
+        if (pool[node].rChild && pos >= pool[pool[node].lChild].count + pool[node].weight)
         {
-            return this->get(node->right, pos - (node->left ? node->left->count : 0) - node->weight);
+            return this->get(pool[node].rChild, pos - pool[pool[node].lChild].count - pool[node].weight);
         }
 
         return node;
     }
 
-    Node* m_root = nullptr;
+    std::shared_ptr<NodePool<Node>> m_pool{};
+    std::uint32_t m_root = 0;
+    std::uint64_t m_seed = LazyImplicitTreap::getDefaultSeed();
 };
 
 struct Key
@@ -5,8 +5,9 @@
 #include <cstdint>
 #include <algorithm>
 #include <limits>
+#include <array>
 
-template <typename T>
+template <typename T, bool isBuffered = false>
 class LazySegTree
 {
 public:
@@ -14,7 +15,10 @@ public:
         m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(size)) },
         m_tree(m_baseSize << 1, T{}),
         m_lazy(m_baseSize << 1, T{}),
-        m_lazyType(m_baseSize << 1, 0)
+        m_lazyType(m_baseSize << 1, 0),
+        m_diff(isBuffered ? m_baseSize + 1 : 0, T{}),
+        m_diffType(isBuffered ? m_baseSize + 1 : 0, 0),
+        m_flushThreshold{ std::max(m_baseSize / ((std::uint64_t)std::log2(m_baseSize) + 1), (std::uint64_t)1) }
     {
     }
 
@@ -22,7 +26,10 @@ public:
         m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(elems.size())) },
         m_tree(m_baseSize << 1, T{}),
         m_lazy(m_baseSize << 1, T{}),
-        m_lazyType(m_baseSize << 1, 0)
+        m_lazyType(m_baseSize << 1, 0),
+        m_diff(isBuffered ? m_baseSize + 1 : 0, T{}),
+        m_diffType(isBuffered ? m_baseSize + 1 : 0, 0),
+        m_flushThreshold{ std::max(m_baseSize / ((std::uint64_t)std::log2(m_baseSize) + 1), (std::uint64_t)1) }
     {
         for (std::uint64_t i = 0; i < elems.size(); i++)
         {
@@ -36,20 +43,169 @@ public:
 
     T query(std::uint64_t l, std::uint64_t r)
     {
+        if constexpr (isBuffered)
+        {
+            this->flushBuffer();
+        }
+
         return this->queryRecursive(1, 0, m_baseSize - 1, l, r);
     }
 
     void updateBy(std::uint64_t l, std::uint64_t r, const T& val)
     {
+        if constexpr (isBuffered)
+        {
+            this->bufferUpdate(l, r, val);
+            return;
+        }
+
         this->updateByRecursive(1, 0, m_baseSize - 1, l, r, val);
     }
 
     void updateReplace(std::uint64_t l, std::uint64_t r, const T& val)
     {
+        if constexpr (isBuffered)
+        {
+            this->flushBuffer();
+        }
+
         this->updateReplaceRecursive(1, 0, m_baseSize - 1, l, r, val);
     }
 
+    template <typename Func>
+    std::int64_t leftBinSearch(std::int64_t l, std::int64_t r, Func func)
+    {
+        if constexpr (isBuffered)
+        {
+            this->flushBuffer();
+        }
+
+        T cumulativePref{};
+        std::int64_t failPos = this->leftBinSearchRecursive(1, 0, m_baseSize - 1, l, r, func, cumulativePref);
+
+        return failPos == -1 ? r : failPos - 1;
+    }
+
+    template <typename Func>
+    std::int64_t rightBinSearch(std::int64_t l, std::int64_t r, Func func)
+    {
+        if constexpr (isBuffered)
+        {
+            this->flushBuffer();
+        }
+
+        T cumulativeSuff{};
+        std::int64_t failPos = this->rightBinSearchRecursive(1, 0, m_baseSize - 1, l, r, func, cumulativeSuff);
+
+        return failPos == -1 ? l : failPos + 1;
+    }
+
+    void setFlushThreshold(std::uint64_t threshold)
+    {
+        this->flushBuffer();
+        m_flushThreshold = std::max(threshold, (std::uint64_t)1);
+    }
+
+    std::uint64_t getBufferedCount() const
+    {
+        return m_bufferedCount;
+    }
+
+    void flushBuffer()
+    {
+        if (!m_bufferedCount)
+        {
+            return;
+        }
+
+        if (m_bufferedCount < m_flushThreshold)
+        {
+            for (const BufferedUpdate& update : m_buffer)
+            {
+                this->updateByRecursive(1, 0, m_baseSize - 1, update.l, update.r, update.val);
+            }
+
+            m_buffer.clear();
+            m_bufferedCount = 0;
+
+            return;
+        }
+
+        for (std::uint64_t levelStart = 1, len = m_baseSize; levelStart < (m_baseSize << 1); levelStart <<= 1, len >>= 1)
+        {
+            for (std::uint64_t i = levelStart; i < (levelStart << 1); i++)
+            {
+                this->propagate(i, (i - levelStart) * len, (i - levelStart + 1) * len - 1);
+            }
+        }
+
+        T cumulativeDiff{};
+        bool hasDiff = false;
+        for (std::uint64_t i = 0; i < m_baseSize; i++)
+        {
+            if (m_diffType[i])
+            {
+                cumulativeDiff = hasDiff ? T::calcLazy(cumulativeDiff, m_diff[i]) : m_diff[i];
+                hasDiff = true;
+
+                m_diffType[i] = 0;
+            }
+
+            if (hasDiff)
+            {
+                m_tree[m_baseSize + i] = T::calcLazy(m_tree[m_baseSize + i], T::calcMany(cumulativeDiff, 1));
+            }
+        }
+        m_diffType[m_baseSize] = 0;
+
+        for (std::uint64_t i = m_baseSize - 1; i > 0; i--)
+        {
+            m_tree[i] = T::calc(m_tree[i << 1], m_tree[(i << 1) + 1]);
+        }
+
+        m_bufferedCount = 0;
+    }
+
 private:
+    struct BufferedUpdate
+    {
+        std::uint64_t l;
+        std::uint64_t r;
+        T val;
+    };
+
+    void bufferUpdate(std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        m_bufferedCount++;
+
+        if (m_bufferedCount < m_flushThreshold)
+        {
+            m_buffer.push_back(BufferedUpdate{ l, r, val });
+            return;
+        }
+
+        if (m_bufferedCount == m_flushThreshold)
+        {
+            for (const BufferedUpdate& update : m_buffer)
+            {
+                this->addDiff(update.l, update.val);
+                this->addDiff(update.r + 1, T::calcInverse(update.val));
+            }
+
+            m_buffer.clear();
+            m_buffer.shrink_to_fit();
+        }
+
+        this->addDiff(l, val);
+        this->addDiff(r + 1, T::calcInverse(val));
+    }
+
+    void addDiff(std::uint64_t pos, const T& val)
+    {
+        m_diff[pos] = m_diffType[pos] ? T::calcLazy(m_diff[pos], val) : val;
+        m_diffType[pos] = 1;
+    }
+
     void propagate(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange)
     {
         if (!m_lazyType[startPos])
@@ -114,6 +270,116 @@ private:
         );
     }
 
+    template <typename Func>
+    std::int64_t leftBinSearchRecursive(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r, Func& func, T& cumulativePref)
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
+        {
+            return -1;
+        }
+
+        this->propagate(startPos, lRange, rRange);
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
+        {
+            T currVal = T::calc(cumulativePref, m_tree[startPos]);
+            if (func(currVal))
+            {
+                cumulativePref = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
+            {
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                this->propagate(startPos << 1, lRange, mid);
+                currVal = T::calc(cumulativePref, m_tree[startPos << 1]);
+
+                if (func(currVal))
+                {
+                    cumulativePref = currVal;
+                    startPos = (startPos << 1) + 1;
+                    lRange = mid + 1;
+
+                    this->propagate(startPos, lRange, rRange);
+                }
+                else
+                {
+                    startPos <<= 1;
+                    rRange = mid;
+                }
+            }
+
+            return lRange;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::int64_t failPos = this->leftBinSearchRecursive(startPos << 1, lRange, mid, l, r, func, cumulativePref);
+        if (failPos != -1)
+        {
+            return failPos;
+        }
+
+        return this->leftBinSearchRecursive((startPos << 1) + 1, mid + 1, rRange, l, r, func, cumulativePref);
+    }
+
+    template <typename Func>
+    std::int64_t rightBinSearchRecursive(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r, Func& func, T& cumulativeSuff)
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
+        {
+            return -1;
+        }
+
+        this->propagate(startPos, lRange, rRange);
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
+        {
+            T currVal = T::calc(m_tree[startPos], cumulativeSuff);
+            if (func(currVal))
+            {
+                cumulativeSuff = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
+            {
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                this->propagate((startPos << 1) + 1, mid + 1, rRange);
+                currVal = T::calc(m_tree[(startPos << 1) + 1], cumulativeSuff);
+
+                if (func(currVal))
+                {
+                    cumulativeSuff = currVal;
+                    startPos <<= 1;
+                    rRange = mid;
+
+                    this->propagate(startPos, lRange, rRange);
+                }
+                else
+                {
+                    startPos = (startPos << 1) + 1;
+                    lRange = mid + 1;
+                }
+            }
+
+            return lRange;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::int64_t failPos = this->rightBinSearchRecursive((startPos << 1) + 1, mid + 1, rRange, l, r, func, cumulativeSuff);
+        if (failPos != -1)
+        {
+            return failPos;
+        }
+
+        return this->rightBinSearchRecursive(startPos << 1, lRange, mid, l, r, func, cumulativeSuff);
+    }
+
     void updateByRecursive(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
     {
         this->propagate(startPos, lRange, rRange);
@@ -172,6 +438,163 @@ private:
     std::vector<T> m_tree;
     std::vector<T> m_lazy;
     std::vector<std::uint8_t> m_lazyType;
+
+    std::vector<T> m_diff;
+    std::vector<std::uint8_t> m_diffType;
+    std::vector<BufferedUpdate> m_buffer{};
+    std::uint64_t m_bufferedCount = 0;
+    std::uint64_t m_flushThreshold;
+};
+
+template <typename T>
+class LazySegTree2d
+{
+public:
+    LazySegTree2d(std::uint64_t sizeI, std::uint64_t sizeJ) :
+        m_sizeI{ sizeI },
+        m_sizeJ{ sizeJ },
+        m_tree((sizeI + 1) * (sizeJ + 1), std::array<T, 4>{})
+    {
+    }
+
+    LazySegTree2d(const std::vector<std::vector<T>>& elems) :
+        m_sizeI{ elems.size() },
+        m_sizeJ{ elems.empty() ? 0 : elems[0].size() },
+        m_tree((m_sizeI + 1) * (m_sizeJ + 1), std::array<T, 4>{})
+    {
+        for (std::uint64_t i = 1; i <= m_sizeI; i++)
+        {
+            for (std::uint64_t j = 1; j <= m_sizeJ; j++)
+            {
+                T diff = elems[i - 1][j - 1];
+                if (i > 1 && j > 1)
+                {
+                    diff = T::calc(diff, elems[i - 2][j - 2]);
+                }
+                if (i > 1)
+                {
+                    diff = T::calc(diff, T::calcInverse(elems[i - 2][j - 1]));
+                }
+                if (j > 1)
+                {
+                    diff = T::calc(diff, T::calcInverse(elems[i - 1][j - 2]));
+                }
+
+                m_tree[i * (m_sizeJ + 1) + j] = {
+                    diff,
+                    T::calcMany(diff, i),
+                    T::calcMany(diff, j),
+                    T::calcMany(diff, i * j)
+                };
+            }
+        }
+
+        for (std::uint64_t i = 1; i <= m_sizeI; i++)
+        {
+            for (std::uint64_t j = 1; j <= m_sizeJ; j++)
+            {
+                std::uint64_t parentJ = j + (j & (~j + 1));
+                if (parentJ <= m_sizeJ)
+                {
+                    this->addCell(i * (m_sizeJ + 1) + parentJ, m_tree[i * (m_sizeJ + 1) + j]);
+                }
+            }
+        }
+        for (std::uint64_t i = 1; i <= m_sizeI; i++)
+        {
+            std::uint64_t parentI = i + (i & (~i + 1));
+            if (parentI > m_sizeI)
+            {
+                continue;
+            }
+            for (std::uint64_t j = 1; j <= m_sizeJ; j++)
+            {
+                this->addCell(parentI * (m_sizeJ + 1) + j, m_tree[i * (m_sizeJ + 1) + j]);
+            }
+        }
+    }
+
+    T query(std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
+    {
+        return T::calc(
+            T::calc(this->queryPref(rI + 1, rJ + 1), this->queryPref(lI, lJ)),
+            T::calcInverse(T::calc(this->queryPref(lI, rJ + 1), this->queryPref(rI + 1, lJ)))
+        );
+    }
+
+    void updateBy(std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ, const T& val)
+    {
+        T inverseVal = T::calcInverse(val);
+
+        this->updateCorner(lI + 1, lJ + 1, val);
+        this->updateCorner(lI + 1, rJ + 2, inverseVal);
+        this->updateCorner(rI + 2, lJ + 1, inverseVal);
+        this->updateCorner(rI + 2, rJ + 2, val);
+    }
+
+    T getElem(std::uint64_t posI, std::uint64_t posJ) const
+    {
+        return this->query(posI, posI, posJ, posJ);
+    }
+
+private:
+    void addCell(std::uint64_t cell, const std::array<T, 4>& vals)
+    {
+        for (std::uint64_t k = 0; k < 4; k++)
+        {
+            m_tree[cell][k] = T::calc(m_tree[cell][k], vals[k]);
+        }
+    }
+
+    void updateCorner(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        if (posI > m_sizeI || posJ > m_sizeJ)
+        {
+            return;
+        }
+
+        std::array<T, 4> vals = {
+            val,
+            T::calcMany(val, posI),
+            T::calcMany(val, posJ),
+            T::calcMany(val, posI * posJ)
+        };
+
+        for (std::uint64_t i = posI; i <= m_sizeI; i += i & (~i + 1))
+        {
+            for (std::uint64_t j = posJ; j <= m_sizeJ; j += j & (~j + 1))
+            {
+                this->addCell(i * (m_sizeJ + 1) + j, vals);
+            }
+        }
+    }
+
+    T queryPref(std::uint64_t posI, std::uint64_t posJ) const
+    {
+        posI = std::min(posI, m_sizeI);
+        posJ = std::min(posJ, m_sizeJ);
+
+        std::array<T, 4> res{};
+        for (std::uint64_t i = posI; i > 0; i -= i & (~i + 1))
+        {
+            for (std::uint64_t j = posJ; j > 0; j -= j & (~j + 1))
+            {
+                for (std::uint64_t k = 0; k < 4; k++)
+                {
+                    res[k] = T::calc(res[k], m_tree[i * (m_sizeJ + 1) + j][k]);
+                }
+            }
+        }
+
+        return T::calc(
+            T::calc(T::calcMany(res[0], (posI + 1) * (posJ + 1)), res[3]),
+            T::calcInverse(T::calc(T::calcMany(res[1], posJ + 1), T::calcMany(res[2], posI + 1)))
+        );
+    }
+
+    std::uint64_t m_sizeI;
+    std::uint64_t m_sizeJ;
+    std::vector<std::array<T, 4>> m_tree;
 };
 
 struct Min
@@ -192,6 +615,11 @@ struct Min
     {
         return Min{ min.val + lazy.val };
     }
+
+    static Min calcInverse(const Min& lazy)
+    {
+        return Min{ -lazy.val };
+    }
 };
 
 struct Max
@@ -212,6 +640,11 @@ struct Max
     {
         return Max{ max.val + lazy.val };
     }
+
+    static Max calcInverse(const Max& lazy)
+    {
+        return Max{ -lazy.val };
+    }
 };
 
 struct Sum
@@ -232,4 +665,9 @@ struct Sum
     {
         return Sum{ sum.val + lazy.val };
     }
+
+    static Sum calcInverse(const Sum& sum)
+    {
+        return Sum{ -sum.val };
+    }
 };
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include <limits>
 #include <memory>
 
+#include "NodePool.h"
+
 template <typename T>
 class LazySparseSegTree
 {
@@ -18,17 +20,31 @@ public:
 
     LazySparseSegTree(const LazySparseSegTree& tree) :
         m_baseSize{ tree.m_baseSize },
-        m_root{ tree.m_root ? new Node(*tree.m_root) : nullptr }
+        m_pool{ tree.m_pool },
+        m_root{ tree.m_root }
     {
+        if (m_root)
+        {
+            m_pool->retain(m_root);
+        }
     }
 
     LazySparseSegTree& operator=(const LazySparseSegTree& tree)
     {
         if (this != &tree)
         {
-            delete m_root;
+            if (tree.m_root)
+            {
+                tree.m_pool->retain(tree.m_root);
+            }
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSize = tree.m_baseSize;
-            m_root = tree.m_root ? new Node(*tree.m_root) : nullptr;
+            m_pool = tree.m_pool;
+            m_root = tree.m_root;
         }
 
         return *this;
@@ -36,21 +52,26 @@ public:
 
     LazySparseSegTree(LazySparseSegTree&& tree) :
         m_baseSize{ tree.m_baseSize },
+        m_pool{ std::move(tree.m_pool) },
         m_root{ tree.m_root }
     {
-        tree.m_baseSize = 0;
-        tree.m_root = nullptr;
+        tree.m_root = 0;
     }
 
     LazySparseSegTree& operator=(LazySparseSegTree&& tree)
     {
         if (this != &tree)
         {
-            delete m_root;
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSize = tree.m_baseSize;
+            m_pool = std::move(tree.m_pool);
             m_root = tree.m_root;
-            tree.m_baseSize = 0;
-            tree.m_root = nullptr;
+
+            tree.m_root = 0;
         }
 
         return *this;
@@ -58,218 +79,290 @@ public:
 
     T query(std::uint64_t l, std::uint64_t r)
     {
-        return m_root ? m_root->query(0, m_baseSize - 1, l, r) : T{};
+        if (!m_root)
+        {
+            return T{};
+        }
+
+        m_root = this->makeExclusive(m_root);
+        return this->queryNode(m_root, 0, m_baseSize - 1, l, r);
     }
 
     void updateBy(std::uint64_t l, std::uint64_t r, const T& val)
     {
-        if (!m_root)
-        {
-            m_root = new Node{};
-        }
-        m_root->updateByRecursive(0, m_baseSize - 1, l, r, val);
+        this->prepareRoot();
+        this->updateByNode(m_root, 0, m_baseSize - 1, l, r, val);
     }
 
     void updateReplace(std::uint64_t l, std::uint64_t r, const T& val)
     {
-        if (!m_root)
+        this->prepareRoot();
+        this->updateReplaceNode(m_root, 0, m_baseSize - 1, l, r, val);
+    }
+
+    std::uint64_t memoryUsage() const
+    {
+        return m_pool ? m_pool->getUsedCount() * sizeof(Node) : 0;
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        if (!m_pool)
         {
-            m_root = new Node{};
+            m_pool = std::make_shared<NodePool<Node>>();
         }
-        m_root->updateReplaceRecursive(0, m_baseSize - 1, l, r, val);
+
+        m_pool->reserve(nodesCount);
     }
 
     ~LazySparseSegTree()
     {
-        if (m_root)
+        if (m_root && m_pool.use_count() > 1)
         {
-            delete m_root;
+            m_pool->release(m_root);
         }
     }
 
 private:
-    class Node
+    struct Node
     {
-    public:
-        Node() = default;
-
-        Node(const Node& node) :
-            m_lChild{ node.m_lChild ? new Node(*node.m_lChild) : nullptr },
-            m_rChild{ node.m_rChild ? new Node(*node.m_rChild) : nullptr },
-            m_data{ node.m_data },
-            m_lazy{ node.m_lazy },
-            m_lazyType{ node.m_lazyType }
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+        T data{};
+        T lazy{};
+        std::uint8_t lazyType = 0;
+        T elem{};
+    };
+
+    void prepareRoot()
+    {
+        if (!m_pool)
         {
+            m_pool = std::make_shared<NodePool<Node>>();
         }
 
-        void propagate(std::uint64_t lRange, std::uint64_t rRange)
+        m_root = m_root ? this->makeExclusive(m_root) : m_pool->allocate();
+    }
+
+    std::uint32_t makeExclusive(std::uint32_t node)
+    {
+        if (!m_pool->isShared(node))
         {
-            if (!m_lazyType)
-            {
-                return;
-            }
+            return node;
+        }
 
-            if (m_lazyType == 1)
-            {
-                m_data = T::calcLazy(m_data, T::calcMany(m_lazy, rRange - lRange + 1));
-            }
-            else
-            {
-                m_data = T::calcMany(m_lazy, rRange - lRange + 1);
-            }
+        std::uint32_t copy = m_pool->allocate();
+        (*m_pool)[copy] = (*m_pool)[node];
 
-            if (lRange != rRange)
-            {
-                if (!m_lChild)
-                {
-                    m_lChild = new Node{};
-                }
-                if (!m_rChild)
-                {
-                    m_rChild = new Node{};
-                }
-
-                if (m_lazyType == 1 && m_lChild->m_lazyType)
-                {
-                    m_lChild->m_lazy = T::calcLazy(m_lChild->m_lazy, m_lazy);
-                }
-                else
-                {
-                    m_lChild->m_lazy = m_lazy;
-                    m_lChild->m_lazyType = m_lazyType;
-                }
-
-                if (m_lazyType == 1 && m_rChild->m_lazyType)
-                {
-                    m_rChild->m_lazy = T::calcLazy(m_rChild->m_lazy, m_lazy);
-                }
-                else
-                {
-                    m_rChild->m_lazy = m_lazy;
-                    m_rChild->m_lazyType = m_lazyType;
-                }
-            }
+        if ((*m_pool)[copy].lChild)
+        {
+            m_pool->retain((*m_pool)[copy].lChild);
+        }
+        if ((*m_pool)[copy].rChild)
+        {
+            m_pool->retain((*m_pool)[copy].rChild);
+        }
+
+        m_pool->release(node);
+
+        return copy;
+    }
+
+    void prepareChildren(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange)
+    {
+        Node& currNode = (*m_pool)[node];
+
+        if (currNode.lChild)
+        {
+            currNode.lChild = this->makeExclusive(currNode.lChild);
+            currNode.rChild = this->makeExclusive(currNode.rChild);
 
-            m_lazyType = 0;
+            return;
         }
 
-        T query(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r)
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        currNode.lChild = m_pool->allocate();
+        currNode.rChild = m_pool->allocate();
+
+        Node& lChild = (*m_pool)[currNode.lChild];
+        lChild.elem = currNode.elem;
+        lChild.data = T::calcMany(currNode.elem, mid - lRange + 1);
+
+        Node& rChild = (*m_pool)[currNode.rChild];
+        rChild.elem = currNode.elem;
+        rChild.data = T::calcMany(currNode.elem, rRange - mid);
+    }
+
+    void collapseChildren(std::uint32_t node)
+    {
+        Node& currNode = (*m_pool)[node];
+        const Node& lChild = (*m_pool)[currNode.lChild];
+        const Node& rChild = (*m_pool)[currNode.rChild];
+
+        if (lChild.lChild || rChild.lChild || lChild.lazyType || rChild.lazyType || !(lChild.elem == rChild.elem))
         {
-            this->propagate(lRange, rRange);
+            return;
+        }
 
-            if (l <= lRange && rRange <= r)
-            {
-                return m_data;
-            }
+        currNode.elem = lChild.elem;
 
-            if (rRange < l || r < lRange)
-            {
-                return T{};
-            }
+        m_pool->release(currNode.lChild);
+        m_pool->release(currNode.rChild);
+        currNode.lChild = 0;
+        currNode.rChild = 0;
+    }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+    void pushLazy(const Node& node, Node& child)
+    {
+        if (node.lazyType == 1 && child.lazyType)
+        {
+            child.lazy = T::calcLazy(child.lazy, node.lazy);
+        }
+        else
+        {
+            child.lazy = node.lazy;
+            child.lazyType = node.lazyType;
+        }
+    }
+
+    void propagate(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange)
+    {
+        Node& currNode = (*m_pool)[node];
 
-            return T::calc(
-                m_lChild ? m_lChild->query(lRange, mid, l, r) : T{},
-                m_rChild ? m_rChild->query(mid + 1, rRange, l, r) : T{}
-            );
+        if (!currNode.lazyType)
+        {
+            return;
         }
 
-        void updateByRecursive(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
+        if (currNode.lazyType == 1)
+        {
+            currNode.data = T::calcLazy(currNode.data, T::calcMany(currNode.lazy, rRange - lRange + 1));
+        }
+        else
         {
-            this->propagate(lRange, rRange);
+            currNode.data = T::calcMany(currNode.lazy, rRange - lRange + 1);
+        }
 
-            if (l <= lRange && rRange <= r)
-            {
-                this->m_lazyType = 1;
-                this->m_lazy = val;
+        if (lRange != rRange && currNode.lChild)
+        {
+            this->prepareChildren(node, lRange, rRange);
 
-                this->propagate(lRange, rRange);
+            this->pushLazy(currNode, (*m_pool)[currNode.lChild]);
+            this->pushLazy(currNode, (*m_pool)[currNode.rChild]);
+        }
+        else
+        {
+            currNode.elem = currNode.lazyType == 1 ? T::calcLazy(currNode.elem, T::calcMany(currNode.lazy, 1)) : currNode.lazy;
+        }
 
-                return;
-            }
+        currNode.lazyType = 0;
+    }
 
-            if (rRange < l || r < lRange)
-            {
-                return;
-            }
+    T queryNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r)
+    {
+        if (rRange < l || r < lRange)
+        {
+            return T{};
+        }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+        this->propagate(node, lRange, rRange);
 
+        Node& currNode = (*m_pool)[node];
 
-            if (!m_lChild)
-            {
-                m_lChild = new Node{};
-            }
-            if (!m_rChild)
-            {
-                m_rChild = new Node{};
-            }
+        if (l <= lRange && rRange <= r)
+        {
+            return currNode.data;
+        }
+
+        if (!currNode.lChild)
+        {
+            return T::calcMany(currNode.elem, std::min(r, rRange) - std::max(l, lRange) + 1);
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
 
-            m_lChild->updateByRecursive(lRange, mid, l, r, val);
-            m_rChild->updateByRecursive(mid + 1, rRange, l, r, val);
+        currNode.lChild = this->makeExclusive(currNode.lChild);
+        currNode.rChild = this->makeExclusive(currNode.rChild);
 
-            m_data = T::calc(m_lChild->m_data, m_rChild->m_data);
+        return T::calc(
+            this->queryNode(currNode.lChild, lRange, mid, l, r),
+            this->queryNode(currNode.rChild, mid + 1, rRange, l, r)
+        );
+    }
+
+    void updateByNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        this->propagate(node, lRange, rRange);
+
+        Node& currNode = (*m_pool)[node];
+
+        if (l <= lRange && rRange <= r)
+        {
+            currNode.lazyType = 1;
+            currNode.lazy = val;
+
+            this->propagate(node, lRange, rRange);
+
+            return;
         }
 
-        void updateReplaceRecursive(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
+        if (rRange < l || r < lRange)
         {
-            this->propagate(lRange, rRange);
+            return;
+        }
 
-            if (l <= lRange && rRange <= r)
-            {
-                this->m_lazyType = 2;
-                this->m_lazy = val;
+        std::uint64_t mid = (lRange + rRange) >> 1;
 
-                this->propagate(lRange, rRange);
+        this->prepareChildren(node, lRange, rRange);
 
-                return;
-            }
+        this->updateByNode(currNode.lChild, lRange, mid, l, r, val);
+        this->updateByNode(currNode.rChild, mid + 1, rRange, l, r, val);
 
-            if (rRange < l || r < lRange)
-            {
-                return;
-            }
+        currNode.data = T::calc((*m_pool)[currNode.lChild].data, (*m_pool)[currNode.rChild].data);
+        this->collapseChildren(node);
+    }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+    void updateReplaceNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        this->propagate(node, lRange, rRange);
 
-            if (!m_lChild)
-            {
-                m_lChild = new Node{};
-            }
-            if (!m_rChild)
-            {
-                m_rChild = new Node{};
-            }
+        Node& currNode = (*m_pool)[node];
+
+        if (l <= lRange && rRange <= r)
+        {
+            m_pool->release(currNode.lChild);
+            m_pool->release(currNode.rChild);
+            currNode.lChild = 0;
+            currNode.rChild = 0;
+
+            currNode.lazyType = 2;
+            currNode.lazy = val;
 
-            m_lChild->updateReplaceRecursive(lRange, mid, l, r, val);
-            m_rChild->updateReplaceRecursive(mid + 1, rRange, l, r, val);
+            this->propagate(node, lRange, rRange);
 
-            m_data = T::calc(m_lChild->m_data, m_rChild->m_data);
+            return;
         }
 
-        ~Node()
+        if (rRange < l || r < lRange)
         {
-            if (m_lChild)
-            {
-                delete m_lChild;
-            }
-            if (m_rChild)
-            {
-                delete m_rChild;
-            }
+            return;
         }
 
-    private:
-        Node* m_lChild = nullptr;
-        Node* m_rChild = nullptr;
-        T m_data{};
-        T m_lazy{};
-        std::uint8_t m_lazyType = 0;
-    };
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        this->prepareChildren(node, lRange, rRange);
+
+        this->updateReplaceNode(currNode.lChild, lRange, mid, l, r, val);
+        this->updateReplaceNode(currNode.rChild, mid + 1, rRange, l, r, val);
+
+        currNode.data = T::calc((*m_pool)[currNode.lChild].data, (*m_pool)[currNode.rChild].data);
+        this->collapseChildren(node);
+    }
 
     std::uint64_t m_baseSize;
-    Node* m_root = nullptr;
+    std::shared_ptr<NodePool<Node>> m_pool{};
+    std::uint32_t m_root = 0;
 };
 
 struct Min
@@ -290,6 +383,8 @@ struct Min
     {
         return Min{ min.val + lazy.val };
     }
+
+    bool operator==(const Min& other) const = default;
 };
 
 struct Max
@@ -310,6 +405,8 @@ struct Max
     {
         return Max{ max.val + lazy.val };
     }
+
+    bool operator==(const Max& other) const = default;
 };
 
 struct Sum
@@ -330,4 +427,6 @@ struct Sum
     {
         return Sum{ sum.val + lazy.val };
     }
+
+    bool operator==(const Sum& other) const = default;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <set>
 #include <cmath>
 #include <cstdint>
+#include <algorithm>
 
 #include "Treap.h"
 
@@ -20,20 +21,29 @@ public:
 
     std::vector<T> getRange(std::uint64_t l, std::uint64_t r) const
     {
-        Treap<KeyType> treapRange = this->getRangeRecursive(1, 0, m_baseSize - 1, l, r);
+        std::vector<std::uint64_t> nodes{};
+        this->getRangeNodes(1, 0, m_baseSize - 1, l, r, nodes);
 
-        if (!treapRange.size())
+        std::vector<T> vals{};
+        for (std::uint64_t node : nodes)
         {
-            return std::vector<T>{};
-        }
+            if (!m_tree[node].size())
+            {
+                continue;
+            }
 
-        std::vector<KeyType> keys = treapRange.getRange(0, treapRange.size() - 1);
+            std::uint64_t mid = vals.size();
+            for (const KeyType& elem : m_tree[node].getRange(0, m_tree[node].size() - 1))
+            {
+                vals.push_back(elem.key);
+            }
 
-        std::vector<T> vals(keys.size());
+            std::inplace_merge(vals.begin(), vals.begin() + mid, vals.end());
+        }
 
-        for (std::uint64_t i = 0; i < vals.size(); i++)
+        if constexpr (isUnique)
         {
-            vals[i] = keys[i].key;
+            vals.erase(std::unique(vals.begin(), vals.end()), vals.end());
         }
 
         return vals;
@@ -78,6 +88,14 @@ private:
 
         this->build(elems, startPos << 1, l, mid);
         this->build(elems, (startPos << 1) + 1, mid + 1, r);
+
+        if constexpr (!isUnique)
+        {
+            m_tree[startPos] = m_tree[startPos << 1];
+            m_tree[startPos].unite(Treap<KeyType>(m_tree[(startPos << 1) + 1]));
+
+            return;
+        }
         
         bool swapped = false;
         if (m_tree[startPos << 1].size() < m_tree[(startPos << 1) + 1].size())
@@ -92,14 +110,7 @@ private:
         {
             for (const KeyType& elem : m_tree[(startPos << 1) + 1].getRange(0, m_tree[(startPos << 1) + 1].size() - 1))
             {
-                if constexpr (isUnique)
-                {
-                    if (!m_tree[startPos].count(elem))
-                    {
-                        m_tree[startPos].insert(elem);
-                    }
-                }
-                else
+                if (!m_tree[startPos].count(elem))
                 {
                     m_tree[startPos].insert(elem);
                 }
@@ -112,47 +123,23 @@ private:
         }
     }
 
-    Treap<KeyType> getRangeRecursive(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r) const
+    void getRangeNodes(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, std::vector<std::uint64_t>& nodes) const
     {
         if (l <= lRange && rRange <= r)
         {
-            return m_tree[startPos];
+            nodes.push_back(startPos);
+            return;
         }
 
         if (rRange < l || r < lRange)
         {
-            return Treap<KeyType>{};
+            return;
         }
 
         std::uint64_t mid = (lRange + rRange) >> 1;
 
-        Treap<KeyType> left = this->getRangeRecursive(startPos << 1, lRange, mid, l, r);
-        Treap<KeyType> right = this->getRangeRecursive((startPos << 1) + 1, mid + 1, rRange, l, r);
-
-        if (left.size() < right.size())
-        {
-            std::swap(left, right);
-        }
-
-        if (right.size())
-        {
-            for (const KeyType& elem : right.getRange(0, right.size() - 1))
-            {
-                if constexpr (isUnique)
-                {
-                    if (!left.count(elem))
-                    {
-                        left.insert(elem);
-                    }
-                }
-                else
-                {
-                    left.insert(elem);
-                }
-            }
-        }
-
-        return left;
+        this->getRangeNodes(startPos << 1, lRange, mid, l, r, nodes);
+        this->getRangeNodes((startPos << 1) + 1, mid + 1, rRange, l, r, nodes);
     }
 
     std::uint64_t queryLessThanRecursive(std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val) const
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <bit>
+#include <iterator>
+#include <algorithm>
+
+template <typename Node>
+class NodePool
+{
+public:
+    NodePool()
+    {
+        this->addChunk(0);
+    }
+
+    NodePool(const NodePool& pool) = delete;
+
+    NodePool& operator=(const NodePool& pool) = delete;
+
+    Node& operator[](std::uint32_t node)
+    {
+        std::uint64_t chunk = NodePool::getChunk(node);
+        return m_chunks[chunk][node - NodePool::getChunkStart(chunk)];
+    }
+
+    const Node& operator[](std::uint32_t node) const
+    {
+        std::uint64_t chunk = NodePool::getChunk(node);
+        return m_chunks[chunk][node - NodePool::getChunkStart(chunk)];
+    }
+
+    std::uint32_t allocate()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::uint32_t node;
+        if (!m_freeNodes.empty())
+        {
+            node = m_freeNodes.back();
+            m_freeNodes.pop_back();
+        }
+        else
+        {
+            node = (std::uint32_t)m_size++;
+
+            std::uint64_t chunk = NodePool::getChunk(node);
+            if (!m_chunks[chunk])
+            {
+                this->addChunk(chunk);
+            }
+        }
+
+        this->getRefs(node).store(1, std::memory_order_relaxed);
+
+        return node;
+    }
+
+    void retain(std::uint32_t node)
+    {
+        this->getRefs(node).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(std::uint32_t node)
+    {
+        if (!node || this->getRefs(node).fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            return;
+        }
+
+        std::vector<std::uint32_t> releasedNodes{ node };
+        while (!releasedNodes.empty())
+        {
+            std::uint32_t curr = releasedNodes.back();
+            releasedNodes.pop_back();
+
+            for (std::uint32_t child : { (*this)[curr].lChild, (*this)[curr].rChild })
+            {
+                if (child && this->getRefs(child).fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    releasedNodes.push_back(child);
+                }
+            }
+
+            (*this)[curr] = Node{};
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeNodes.push_back(curr);
+        }
+    }
+
+    bool isShared(std::uint32_t node) const
+    {
+        return this->getRefs(node).load(std::memory_order_acquire) != 1;
+    }
+
+    std::uint64_t getUsedCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return m_size - 1 - m_freeNodes.size();
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (std::uint64_t chunk = 0; chunk <= NodePool::getChunk(nodesCount); chunk++)
+        {
+            if (!m_chunks[chunk])
+            {
+                this->addChunk(chunk);
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint64_t m_firstChunkSize = 64;
+
+    static std::uint64_t getChunk(std::uint64_t node)
+    {
+        return std::bit_width(node / m_firstChunkSize + 1) - 1;
+    }
+
+    static std::uint64_t getChunkStart(std::uint64_t chunk)
+    {
+        return m_firstChunkSize * (((std::uint64_t)1 << chunk) - 1);
+    }
+
+    std::atomic<std::uint32_t>& getRefs(std::uint32_t node) const
+    {
+        std::uint64_t chunk = NodePool::getChunk(node);
+        return m_refs[chunk][node - NodePool::getChunkStart(chunk)];
+    }
+
+    void addChunk(std::uint64_t chunk)
+    {
+        m_chunks[chunk] = std::make_unique<Node[]>(m_firstChunkSize << chunk);
+        m_refs[chunk] = std::make_unique<std::atomic<std::uint32_t>[]>(m_firstChunkSize << chunk);
+    }
+
+    std::unique_ptr<Node[]> m_chunks[32]{};
+    std::unique_ptr<std::atomic<std::uint32_t>[]> m_refs[32]{};
+    std::uint64_t m_size = 1;
+    std::vector<std::uint32_t> m_freeNodes{};
+    mutable std::mutex m_mutex{};
+};
+
+template <typename T>
+class ChunkedVector
+{
+public:
+    ChunkedVector() = default;
+
+    ChunkedVector(const ChunkedVector& vec)
+    {
+        *this = vec;
+    }
+
+    ChunkedVector& operator=(const ChunkedVector& vec)
+    {
+        if (this != &vec)
+        {
+            this->clear();
+            this->reserve(vec.m_size);
+
+            for (std::uint64_t i = 0; i < vec.m_size; i++)
+            {
+                this->push_back(vec[i]);
+            }
+        }
+
+        return *this;
+    }
+
+    ChunkedVector(ChunkedVector&& vec) :
+        m_size{ vec.m_size }
+    {
+        std::move(std::begin(vec.m_chunks), std::end(vec.m_chunks), std::begin(m_chunks));
+        vec.m_size = 0;
+    }
+
+    ChunkedVector& operator=(ChunkedVector&& vec)
+    {
+        if (this != &vec)
+        {
+            std::move(std::begin(vec.m_chunks), std::end(vec.m_chunks), std::begin(m_chunks));
+            m_size = vec.m_size;
+
+            vec.m_size = 0;
+        }
+
+        return *this;
+    }
+
+    T& operator[](std::uint64_t pos)
+    {
+        std::uint64_t chunk = ChunkedVector::getChunk(pos);
+        return m_chunks[chunk][pos - ChunkedVector::getChunkStart(chunk)];
+    }
+
+    const T& operator[](std::uint64_t pos) const
+    {
+        std::uint64_t chunk = ChunkedVector::getChunk(pos);
+        return m_chunks[chunk][pos - ChunkedVector::getChunkStart(chunk)];
+    }
+
+    std::uint64_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return !m_size;
+    }
+
+    void push_back(const T& val)
+    {
+        std::uint64_t chunk = ChunkedVector::getChunk(m_size);
+        if (!m_chunks[chunk])
+        {
+            m_chunks[chunk] = std::make_unique<T[]>(m_firstChunkSize << chunk);
+        }
+
+        m_chunks[chunk][m_size - ChunkedVector::getChunkStart(chunk)] = val;
+        m_size++;
+    }
+
+    void reserve(std::uint64_t size)
+    {
+        if (!size)
+        {
+            return;
+        }
+
+        for (std::uint64_t chunk = 0; chunk <= ChunkedVector::getChunk(size - 1); chunk++)
+        {
+            if (!m_chunks[chunk])
+            {
+                m_chunks[chunk] = std::make_unique<T[]>(m_firstChunkSize << chunk);
+            }
+        }
+    }
+
+    void resize(std::uint64_t size)
+    {
+        while (m_size < size)
+        {
+            this->push_back(T{});
+        }
+        m_size = size;
+    }
+
+    void shrink_to_fit()
+    {
+        for (std::uint64_t chunk = m_size ? ChunkedVector::getChunk(m_size - 1) + 1 : 0; chunk < 32; chunk++)
+        {
+            m_chunks[chunk].reset();
+        }
+    }
+
+    void clear()
+    {
+        m_size = 0;
+        this->shrink_to_fit();
+    }
+
+private:
+    static constexpr std::uint64_t m_firstChunkSize = 64;
+
+    static std::uint64_t getChunk(std::uint64_t pos)
+    {
+        return std::bit_width(pos / m_firstChunkSize + 1) - 1;
+    }
+
+    static std::uint64_t getChunkStart(std::uint64_t chunk)
+    {
+        return m_firstChunkSize * (((std::uint64_t)1 << chunk) - 1);
+    }
+
+    std::unique_ptr<T[]> m_chunks[32]{};
+    std::uint64_t m_size = 0;
+};
+
+template <typename Node>
+class FreeListPool
+{
+public:
+    Node& operator[](std::uint32_t node)
+    {
+        return m_nodes[node];
+    }
+
+    const Node& operator[](std::uint32_t node) const
+    {
+        return m_nodes[node];
+    }
+
+    std::uint32_t allocate(const Node& node)
+    {
+        if (m_nodes.empty())
+        {
+            m_nodes.push_back(Node{});
+        }
+
+        if (!m_freeNodes.empty())
+        {
+            std::uint32_t newNode = m_freeNodes.back();
+            m_freeNodes.pop_back();
+
+            m_nodes[newNode] = node;
+
+            return newNode;
+        }
+
+        m_nodes.push_back(node);
+
+        return (std::uint32_t)(m_nodes.size() - 1);
+    }
+
+    void deallocate(std::uint32_t node)
+    {
+        m_freeNodes.push_back(node);
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        m_nodes.reserve(nodesCount + 1);
+    }
+
+    std::uint64_t getUsedCount() const
+    {
+        return m_nodes.empty() ? 0 : m_nodes.size() - 1 - m_freeNodes.size();
+    }
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_freeNodes.clear();
+    }
+
+private:
+    std::vector<Node> m_nodes{};
+    std::vector<std::uint32_t> m_freeNodes{};
+};
\ No newline at end of file
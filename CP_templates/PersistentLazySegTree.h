@@ -0,0 +1,404 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+
+template <typename T, typename IndexType = std::uint64_t>
+class PersistentLazySegTree
+{
+public:
+    PersistentLazySegTree(std::uint64_t size) :
+        m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(size)) }
+    {
+        this->init(0, m_baseSize - 1, size - 1, std::vector<T>(size));
+    }
+
+    PersistentLazySegTree(const std::vector<T>& elems) :
+        m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(elems.size())) }
+    {
+        this->init(0, m_baseSize - 1, elems.size() - 1, elems);
+    }
+
+    std::uint64_t getInitRoot() const
+    {
+        return 0;
+    }
+
+    T query(std::uint64_t root, std::uint64_t l, std::uint64_t r) const
+    {
+        return this->queryNode(root, 0, m_baseSize - 1, l, r, Mark{});
+    }
+
+    std::uint64_t updateBy(std::uint64_t root, std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        return this->updateByNode(root, 0, m_baseSize - 1, l, r, val);
+    }
+
+    void reserve(std::uint64_t updatesCount)
+    {
+        std::uint64_t nodesCount = updatesCount * (((std::uint64_t)std::log2(m_baseSize) + 1) << 2);
+
+        PersistentLazySegTree::checkNodesCount(m_nodes.size() + nodesCount);
+        m_nodes.reserve(m_nodes.size() + nodesCount);
+    }
+
+    std::int64_t leftBinSearch(const std::vector<std::uint64_t>& roots, std::int64_t l, std::int64_t r, std::function<bool(const std::vector<T>&)> func) const
+    {
+        std::vector<T> cumulativePref(roots.size());
+        std::int64_t failPos = this->leftBinSearchNode(roots, std::vector<Mark>(roots.size()), 0, m_baseSize - 1, l, r, func, cumulativePref);
+
+        return failPos == -1 ? r : failPos - 1;
+    }
+
+    std::int64_t rightBinSearch(const std::vector<std::uint64_t>& roots, std::int64_t l, std::int64_t r, std::function<bool(const std::vector<T>&)> func) const
+    {
+        std::vector<T> cumulativeSuff(roots.size());
+        std::int64_t failPos = this->rightBinSearchNode(roots, std::vector<Mark>(roots.size()), 0, m_baseSize - 1, l, r, func, cumulativeSuff);
+
+        return failPos == -1 ? l : failPos + 1;
+    }
+
+private:
+    struct Mark
+    {
+        T val{};
+        bool isSet = false;
+    };
+
+    struct Node
+    {
+        IndexType lChild = std::numeric_limits<IndexType>::max();
+        IndexType rChild = std::numeric_limits<IndexType>::max();
+        T data{};
+        Mark mark{};
+    };
+
+    static Mark addMark(const Mark& mark, const Mark& newMark)
+    {
+        if (!newMark.isSet)
+        {
+            return mark;
+        }
+
+        return Mark{ mark.isSet ? T::calcLazy(mark.val, newMark.val) : newMark.val, true };
+    }
+
+    static T applyMark(const T& data, const Mark& mark, std::uint64_t count)
+    {
+        return mark.isSet ? T::calcLazy(data, T::calcMany(mark.val, count)) : data;
+    }
+
+    static void checkNodesCount(std::uint64_t nodesCount)
+    {
+        if (nodesCount > std::numeric_limits<IndexType>::max())
+        {
+            throw std::runtime_error("PersistentLazySegTree: node count exceeds IndexType range");
+        }
+    }
+
+    std::uint64_t init(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t maxR, const std::vector<T>& elems)
+    {
+        std::uint64_t curr = m_nodes.size();
+        PersistentLazySegTree::checkNodesCount(curr + 1);
+        m_nodes.push_back(Node{});
+
+        if (maxR < lRange)
+        {
+            return curr;
+        }
+
+        if (lRange != rRange)
+        {
+            std::uint64_t mid = (lRange + rRange) >> 1;
+
+            std::uint64_t l = this->init(lRange, mid, maxR, elems);
+            std::uint64_t r = this->init(mid + 1, rRange, maxR, elems);
+
+            m_nodes[curr].lChild = (IndexType)l;
+            m_nodes[curr].rChild = (IndexType)r;
+
+            m_nodes[curr].data = T::calc(
+                m_nodes[l].data,
+                m_nodes[r].data
+            );
+        }
+        else
+        {
+            m_nodes[curr].data = elems[lRange];
+        }
+        return curr;
+    }
+
+    T queryNode(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const Mark& mark) const
+    {
+        if (rRange < l || r < lRange)
+        {
+            return T{};
+        }
+
+        if (l <= lRange && rRange <= r)
+        {
+            return PersistentLazySegTree::applyMark(m_nodes[node].data, mark, rRange - lRange + 1);
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+        Mark childMark = PersistentLazySegTree::addMark(mark, m_nodes[node].mark);
+
+        return T::calc(
+            this->queryNode(m_nodes[node].lChild, lRange, mid, l, r, childMark),
+            this->queryNode(m_nodes[node].rChild, mid + 1, rRange, l, r, childMark)
+        );
+    }
+
+    std::uint64_t updateByNode(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r, const T& val)
+    {
+        if (rRange < l || r < lRange)
+        {
+            return node;
+        }
+
+        std::uint64_t newNodeIdx = m_nodes.size();
+        PersistentLazySegTree::checkNodesCount(newNodeIdx + 1);
+        m_nodes.push_back(m_nodes[node]);
+
+        if (l <= lRange && rRange <= r)
+        {
+            m_nodes[newNodeIdx].mark = PersistentLazySegTree::addMark(m_nodes[newNodeIdx].mark, Mark{ val, true });
+            m_nodes[newNodeIdx].data = T::calcLazy(m_nodes[newNodeIdx].data, T::calcMany(val, rRange - lRange + 1));
+
+            return newNodeIdx;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::uint64_t lChild = this->updateByNode(m_nodes[node].lChild, lRange, mid, l, r, val);
+        std::uint64_t rChild = this->updateByNode(m_nodes[node].rChild, mid + 1, rRange, l, r, val);
+
+        m_nodes[newNodeIdx].lChild = (IndexType)lChild;
+        m_nodes[newNodeIdx].rChild = (IndexType)rChild;
+
+        m_nodes[newNodeIdx].data = PersistentLazySegTree::applyMark(
+            T::calc(m_nodes[lChild].data, m_nodes[rChild].data),
+            m_nodes[newNodeIdx].mark,
+            rRange - lRange + 1
+        );
+
+        return newNodeIdx;
+    }
+
+    std::int64_t leftBinSearchNode(std::vector<std::uint64_t> nodes, std::vector<Mark> marks, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r,
+        std::function<bool(const std::vector<T>&)>& func, std::vector<T>& cumulativePref) const
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
+        {
+            return -1;
+        }
+
+        std::vector<T> currVal(nodes.size());
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
+        {
+            for (std::uint64_t i = 0; i < nodes.size(); i++)
+            {
+                currVal[i] = T::calc(cumulativePref[i], PersistentLazySegTree::applyMark(m_nodes[nodes[i]].data, marks[i], rRange - lRange + 1));
+            }
+            if (func(currVal))
+            {
+                cumulativePref = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
+            {
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                for (std::uint64_t i = 0; i < nodes.size(); i++)
+                {
+                    marks[i] = PersistentLazySegTree::addMark(marks[i], m_nodes[nodes[i]].mark);
+                    currVal[i] = T::calc(cumulativePref[i], PersistentLazySegTree::applyMark(m_nodes[m_nodes[nodes[i]].lChild].data, marks[i], mid - lRange + 1));
+                }
+
+                if (func(currVal))
+                {
+                    cumulativePref = currVal;
+                    for (std::uint64_t i = 0; i < nodes.size(); i++)
+                    {
+                        nodes[i] = m_nodes[nodes[i]].rChild;
+                    }
+                    lRange = mid + 1;
+                }
+                else
+                {
+                    for (std::uint64_t i = 0; i < nodes.size(); i++)
+                    {
+                        nodes[i] = m_nodes[nodes[i]].lChild;
+                    }
+                    rRange = mid;
+                }
+            }
+
+            return lRange;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::vector<std::uint64_t> lChilds(nodes.size());
+        std::vector<std::uint64_t> rChilds(nodes.size());
+        for (std::uint64_t i = 0; i < nodes.size(); i++)
+        {
+            marks[i] = PersistentLazySegTree::addMark(marks[i], m_nodes[nodes[i]].mark);
+            lChilds[i] = m_nodes[nodes[i]].lChild;
+            rChilds[i] = m_nodes[nodes[i]].rChild;
+        }
+
+        std::int64_t failPos = this->leftBinSearchNode(lChilds, marks, lRange, mid, l, r, func, cumulativePref);
+        if (failPos != -1)
+        {
+            return failPos;
+        }
+
+        return this->leftBinSearchNode(rChilds, marks, mid + 1, rRange, l, r, func, cumulativePref);
+    }
+
+    std::int64_t rightBinSearchNode(std::vector<std::uint64_t> nodes, std::vector<Mark> marks, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r,
+        std::function<bool(const std::vector<T>&)>& func, std::vector<T>& cumulativeSuff) const
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
+        {
+            return -1;
+        }
+
+        std::vector<T> currVal(nodes.size());
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
+        {
+            for (std::uint64_t i = 0; i < nodes.size(); i++)
+            {
+                currVal[i] = T::calc(PersistentLazySegTree::applyMark(m_nodes[nodes[i]].data, marks[i], rRange - lRange + 1), cumulativeSuff[i]);
+            }
+            if (func(currVal))
+            {
+                cumulativeSuff = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
+            {
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                for (std::uint64_t i = 0; i < nodes.size(); i++)
+                {
+                    marks[i] = PersistentLazySegTree::addMark(marks[i], m_nodes[nodes[i]].mark);
+                    currVal[i] = T::calc(PersistentLazySegTree::applyMark(m_nodes[m_nodes[nodes[i]].rChild].data, marks[i], rRange - mid), cumulativeSuff[i]);
+                }
+
+                if (func(currVal))
+                {
+                    cumulativeSuff = currVal;
+                    for (std::uint64_t i = 0; i < nodes.size(); i++)
+                    {
+                        nodes[i] = m_nodes[nodes[i]].lChild;
+                    }
+                    rRange = mid;
+                }
+                else
+                {
+                    for (std::uint64_t i = 0; i < nodes.size(); i++)
+                    {
+                        nodes[i] = m_nodes[nodes[i]].rChild;
+                    }
+                    lRange = mid + 1;
+                }
+            }
+
+            return lRange;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::vector<std::uint64_t> lChilds(nodes.size());
+        std::vector<std::uint64_t> rChilds(nodes.size());
+        for (std::uint64_t i = 0; i < nodes.size(); i++)
+        {
+            marks[i] = PersistentLazySegTree::addMark(marks[i], m_nodes[nodes[i]].mark);
+            lChilds[i] = m_nodes[nodes[i]].lChild;
+            rChilds[i] = m_nodes[nodes[i]].rChild;
+        }
+
+        std::int64_t failPos = this->rightBinSearchNode(rChilds, marks, mid + 1, rRange, l, r, func, cumulativeSuff);
+        if (failPos != -1)
+        {
+            return failPos;
+        }
+
+        return this->rightBinSearchNode(lChilds, marks, lRange, mid, l, r, func, cumulativeSuff);
+    }
+
+    std::uint64_t m_baseSize;
+    std::vector<Node> m_nodes{};
+};
+
+struct Min
+{
+    std::int64_t val = std::numeric_limits<std::int64_t>::max();
+
+    static Min calc(const Min& left, const Min& right)
+    {
+        return Min{ std::min(left.val, right.val) };
+    }
+
+    static Min calcMany(const Min& min, std::uint64_t count)
+    {
+        return Min{ min.val };
+    }
+
+    static Min calcLazy(const Min& min, const Min& lazy)
+    {
+        return Min{ min.val + lazy.val };
+    }
+};
+
+struct Max
+{
+    std::int64_t val = std::numeric_limits<std::int64_t>::min();
+
+    static Max calc(const Max& left, const Max& right)
+    {
+        return Max{ std::max(left.val, right.val) };
+    }
+
+    static Max calcMany(const Max& max, std::uint64_t count)
+    {
+        return Max{ max.val };
+    }
+
+    static Max calcLazy(const Max& max, const Max& lazy)
+    {
+        return Max{ max.val + lazy.val };
+    }
+};
+
+struct Sum
+{
+    std::int64_t val = 0;
+
+    static Sum calc(const Sum& left, const Sum& right)
+    {
+        return Sum{ left.val + right.val };
+    }
+
+    static Sum calcMany(const Sum& sum, std::uint64_t count)
+    {
+        return Sum{ sum.val * (std::int64_t)count };
+    }
+
+    static Sum calcLazy(const Sum& sum, const Sum& lazy)
+    {
+        return Sum{ sum.val + lazy.val };
+    }
+};
\ No newline at end of file
@@ -7,8 +7,33 @@
 #include <limits>
 #include <memory>
 #include <functional>
-
-template <typename T>
+#include <array>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <type_traits>
+#include <future>
+#include <thread>
+#include <bit>
+#include <atomic>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "NodePool.h"
+
+template <typename T, typename IndexType = std::uint64_t, bool isConcurrent = false>
 class PersistentSegTree
 {
 public:
@@ -28,13 +53,53 @@ public:
 
     PersistentSegTree& operator=(const PersistentSegTree& tree) = default;
 
-    PersistentSegTree(PersistentSegTree&& tree) = default;
+    PersistentSegTree(PersistentSegTree&& tree) :
+        m_baseSize{ tree.m_baseSize },
+        m_nodes{ std::move(tree.m_nodes) },
+        m_initRoot{ tree.m_initRoot },
+        m_liveRoots{ std::move(tree.m_liveRoots) },
+        m_latestRoot{ tree.m_latestRoot },
+        m_mapping{ std::move(tree.m_mapping) },
+        m_mappedNodes{ tree.m_mappedNodes },
+        m_mappedNodesCount{ tree.m_mappedNodesCount }
+    {
+        tree.m_mappedNodes = nullptr;
+        tree.m_mappedNodesCount = 0;
+    }
 
-    PersistentSegTree& operator=(PersistentSegTree&& tree) = default;
+    PersistentSegTree& operator=(PersistentSegTree&& tree)
+    {
+        if (this != &tree)
+        {
+            m_baseSize = tree.m_baseSize;
+            m_nodes = std::move(tree.m_nodes);
+            m_initRoot = tree.m_initRoot;
+            m_liveRoots = std::move(tree.m_liveRoots);
+            m_latestRoot = tree.m_latestRoot;
+            m_mapping = std::move(tree.m_mapping);
+            m_mappedNodes = tree.m_mappedNodes;
+            m_mappedNodesCount = tree.m_mappedNodesCount;
+
+            tree.m_mappedNodes = nullptr;
+            tree.m_mappedNodesCount = 0;
+        }
+
+        return *this;
+    }
 
     std::uint64_t getInitRoot() const
     {
-        return 0;
+        return m_initRoot;
+    }
+
+    const std::vector<std::uint64_t>& getLiveRoots() const
+    {
+        return m_liveRoots;
+    }
+
+    std::uint64_t getLatestRoot() const
+    {
+        return m_latestRoot.root.load(std::memory_order_acquire);
     }
 
     T query(std::uint64_t root, std::uint64_t l, std::uint64_t r) const
@@ -44,11 +109,189 @@ public:
 
     std::uint64_t update(std::uint64_t root, const std::vector<std::pair<std::uint64_t, T>>& changes)
     {
-        return updateNode(root, 0, m_baseSize - 1, changes);
+        if (!PersistentSegTree::isSortedChanges(changes))
+        {
+            return this->update(root, PersistentSegTree::getSortedChanges(changes));
+        }
+
+        if constexpr (!isConcurrent)
+        {
+            this->detach();
+        }
+
+        std::uint64_t newRoot = updateNode(root, 0, m_baseSize - 1, changes, 0, changes.size(), m_nodes, m_mappedNodesCount);
+        m_liveRoots.push_back(newRoot);
+        m_latestRoot.root.store(newRoot, std::memory_order_release);
+
+        return newRoot;
+    }
+
+    std::uint64_t updateParallel(std::uint64_t root, const std::vector<std::pair<std::uint64_t, T>>& changes,
+        std::uint64_t tasksCount = std::max(std::thread::hardware_concurrency(), 1u))
+    {
+        if (!PersistentSegTree::isSortedChanges(changes))
+        {
+            return this->updateParallel(root, PersistentSegTree::getSortedChanges(changes), tasksCount);
+        }
+
+        std::uint64_t depth = std::bit_width(tasksCount - 1);
+        if (!depth || changes.empty())
+        {
+            return this->update(root, changes);
+        }
+
+        if constexpr (!isConcurrent)
+        {
+            this->detach();
+        }
+
+        std::vector<std::future<std::pair<std::vector<Node>, std::uint64_t>>> tasks{};
+        this->launchParallelTasks(root, 0, m_baseSize - 1, changes, 0, changes.size(), depth, tasks);
+
+        std::uint64_t bufferStart = this->getNodesCount();
+        std::vector<std::pair<std::vector<Node>, std::uint64_t>> results{};
+        std::uint64_t newNodesCount = 0;
+        for (std::future<std::pair<std::vector<Node>, std::uint64_t>>& task : tasks)
+        {
+            results.push_back(task.get());
+            newNodesCount += results.back().first.size();
+        }
+        PersistentSegTree::checkNodesCount(this->getNodesCount() + newNodesCount);
+        m_nodes.reserve(m_nodes.size() + newNodesCount + (tasks.size() << 1) * (depth + 1));
+
+        std::vector<std::uint64_t> tasksRoots{};
+        for (std::pair<std::vector<Node>, std::uint64_t>& result : results)
+        {
+            std::uint64_t offset = this->getNodesCount() - bufferStart;
+            for (Node& node : result.first)
+            {
+                if (node.lChild != std::numeric_limits<IndexType>::max() && node.lChild >= bufferStart)
+                {
+                    node.lChild = (IndexType)(node.lChild + offset);
+                }
+                if (node.rChild != std::numeric_limits<IndexType>::max() && node.rChild >= bufferStart)
+                {
+                    node.rChild = (IndexType)(node.rChild + offset);
+                }
+            }
+
+            tasksRoots.push_back(result.second + offset);
+            for (const Node& node : result.first)
+            {
+                m_nodes.push_back(node);
+            }
+        }
+
+        std::uint64_t currTask = 0;
+        std::uint64_t newRoot = this->joinParallelTasks(root, 0, m_baseSize - 1, changes, 0, changes.size(), depth, tasksRoots, currTask);
+        m_liveRoots.push_back(newRoot);
+        m_latestRoot.root.store(newRoot, std::memory_order_release);
+
+        return newRoot;
+    }
+
+    void releaseRoot(std::uint64_t root)
+    {
+        std::vector<std::uint64_t>::iterator it = std::lower_bound(m_liveRoots.begin(), m_liveRoots.end(), root);
+        if (it != m_liveRoots.end() && *it == root)
+        {
+            m_liveRoots.erase(it);
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> compact()
+    {
+        const std::uint64_t nullIdx = std::numeric_limits<std::uint64_t>::max();
+
+        this->detach();
+
+        std::vector<std::uint64_t> newIdx(m_nodes.size(), nullIdx);
+        std::vector<std::uint64_t> stack(m_liveRoots.begin(), m_liveRoots.end());
+
+        while (!stack.empty())
+        {
+            std::uint64_t node = stack.back();
+            stack.pop_back();
+
+            if (newIdx[node] != nullIdx)
+            {
+                continue;
+            }
+            newIdx[node] = 0;
+
+            for (IndexType child : { m_nodes[node].lChild, m_nodes[node].rChild })
+            {
+                if (child != std::numeric_limits<IndexType>::max() && newIdx[child] == nullIdx)
+                {
+                    stack.push_back(child);
+                }
+            }
+        }
+
+        std::uint64_t nodesCount = 0;
+        for (std::uint64_t node = 0; node < m_nodes.size(); node++)
+        {
+            if (newIdx[node] != nullIdx)
+            {
+                newIdx[node] = nodesCount++;
+            }
+        }
+
+        for (std::uint64_t node = 0; node < m_nodes.size(); node++)
+        {
+            if (newIdx[node] == nullIdx)
+            {
+                continue;
+            }
+
+            Node& currNode = m_nodes[newIdx[node]];
+            currNode = m_nodes[node];
+
+            if (currNode.lChild != std::numeric_limits<IndexType>::max())
+            {
+                currNode.lChild = (IndexType)newIdx[currNode.lChild];
+            }
+            if (currNode.rChild != std::numeric_limits<IndexType>::max())
+            {
+                currNode.rChild = (IndexType)newIdx[currNode.rChild];
+            }
+        }
+
+        m_nodes.resize(nodesCount);
+        m_nodes.shrink_to_fit();
+
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> remappedRoots{};
+        for (std::uint64_t& root : m_liveRoots)
+        {
+            remappedRoots.push_back({ root, newIdx[root] });
+            root = newIdx[root];
+        }
+
+        m_initRoot = m_initRoot < newIdx.size() ? newIdx[m_initRoot] : nullIdx;
+
+        std::uint64_t latestRoot = m_latestRoot.root.load(std::memory_order_relaxed);
+        m_latestRoot.root.store(latestRoot < newIdx.size() ? newIdx[latestRoot] : nullIdx, std::memory_order_release);
+
+        return remappedRoots;
+    }
+
+    void reserve(std::uint64_t versions, std::uint64_t changesPerVersion)
+    {
+        if constexpr (!isConcurrent)
+        {
+            this->detach();
+        }
+
+        std::uint64_t nodesCount = versions * changesPerVersion * ((std::uint64_t)std::log2(m_baseSize) + 1);
+
+        PersistentSegTree::checkNodesCount(this->getNodesCount() + nodesCount);
+        m_nodes.reserve(m_nodes.size() + nodesCount);
     }
 
     std::int64_t leftBinSearch(const std::vector<std::uint64_t>& roots, std::int64_t l, std::int64_t r, std::function<bool(const std::vector<T>&)> func) const
     {
+        NodesView nodes = this->getNodes();
+
         std::vector<std::pair<std::uint64_t, std::vector<std::uint64_t>>> partsRoots{};
 
         for (std::uint64_t i = 0; i < roots.size(); i++)
@@ -72,13 +315,13 @@ public:
         std::vector<std::vector<T>> prefNodes(partsRoots.size(), std::vector<T>(roots.size()));
         for (std::uint64_t i = 0; i < roots.size(); i++)
         {
-            prefNodes[0][i] = m_nodes[partsRoots[0].second[i]].data;
+            prefNodes[0][i] = nodes[partsRoots[0].second[i]].data;
         }
         for (std::uint64_t i = 1; i < partsRoots.size(); i++)
         {
             for (std::uint64_t j = 0; j < roots.size(); j++)
             {
-                prefNodes[i][j] = T::calc(prefNodes[i - 1][j], m_nodes[partsRoots[i].second[j]].data);
+                prefNodes[i][j] = T::calc(prefNodes[i - 1][j], nodes[partsRoots[i].second[j]].data);
             }
         }
 
@@ -103,7 +346,7 @@ public:
             std::vector<T> currVal(roots.size());
             for (std::uint64_t i = 0; i < roots.size(); i++)
             {
-                currVal[i] = T::calc(cumulativePref[i], m_nodes[m_nodes[currNode.second[i]].lChild].data);
+                currVal[i] = T::calc(cumulativePref[i], nodes[nodes[currNode.second[i]].lChild].data);
             }
 
             if (func(currVal))
@@ -111,7 +354,7 @@ public:
                 std::vector<std::uint64_t> currNodeRChilds(roots.size());
                 for (std::uint64_t i = 0; i < roots.size(); i++)
                 {
-                    currNodeRChilds[i] = m_nodes[currNode.second[i]].rChild;
+                    currNodeRChilds[i] = nodes[currNode.second[i]].rChild;
                 }
                 cumulativePref = currVal;
                 currNode = { (currNode.first << 1) + 1, currNodeRChilds };
@@ -121,7 +364,7 @@ public:
                 std::vector<std::uint64_t> currNodeLChilds(roots.size());
                 for (std::uint64_t i = 0; i < roots.size(); i++)
                 {
-                    currNodeLChilds[i] = m_nodes[currNode.second[i]].lChild;
+                    currNodeLChilds[i] = nodes[currNode.second[i]].lChild;
                 }
                 currNode = { currNode.first << 1, currNodeLChilds };
             }
@@ -130,7 +373,7 @@ public:
         std::vector<T> currVal(roots.size());
         for (std::uint64_t i = 0; i < roots.size(); i++)
         {
-            currVal[i] = T::calc(cumulativePref[i], m_nodes[currNode.second[i]].data);
+            currVal[i] = T::calc(cumulativePref[i], nodes[currNode.second[i]].data);
         }
 
         if (func(currVal))
@@ -143,6 +386,8 @@ public:
 
     std::int64_t rightBinSearch(const std::vector<std::uint64_t>& roots, std::int64_t l, std::int64_t r, std::function<bool(const std::vector<T>&)> func) const
     {
+        NodesView nodes = this->getNodes();
+
         std::vector<std::pair<std::uint64_t, std::vector<std::uint64_t>>> partsRoots{};
 
         for (std::uint64_t i = 0; i < roots.size(); i++)
@@ -166,13 +411,13 @@ public:
         std::vector<std::vector<T>> suffNodes(partsRoots.size(), std::vector<T>(roots.size()));
         for (std::uint64_t i = 0; i < roots.size(); i++)
         {
-            suffNodes.back()[i] = m_nodes[partsRoots.back().second[i]].data;
+            suffNodes.back()[i] = nodes[partsRoots.back().second[i]].data;
         }
         for (std::int64_t i = partsRoots.size() - 2; i >= 0; i--)
         {
             for (std::uint64_t j = 0; j < roots.size(); j++)
             {
-                suffNodes[i][j] = T::calc(m_nodes[partsRoots[i].second[j]].data, suffNodes[i + 1][j]);
+                suffNodes[i][j] = T::calc(nodes[partsRoots[i].second[j]].data, suffNodes[i + 1][j]);
             }
         }
 
@@ -197,7 +442,7 @@ public:
             std::vector<T> currVal(roots.size());
             for (std::uint64_t i = 0; i < roots.size(); i++)
             {
-                currVal[i] = T::calc(m_nodes[m_nodes[currNode.second[i]].rChild].data, cumulativeSuff[i]);
+                currVal[i] = T::calc(nodes[nodes[currNode.second[i]].rChild].data, cumulativeSuff[i]);
             }
 
             if (func(currVal))
@@ -205,7 +450,7 @@ public:
                 std::vector<std::uint64_t> currNodeLChilds(roots.size());
                 for (std::uint64_t i = 0; i < roots.size(); i++)
                 {
-                    currNodeLChilds[i] = m_nodes[currNode.second[i]].lChild;
+                    currNodeLChilds[i] = nodes[currNode.second[i]].lChild;
                 }
                 cumulativeSuff = currVal;
                 currNode = { currNode.first << 1, currNodeLChilds };
@@ -215,7 +460,7 @@ public:
                 std::vector<std::uint64_t> currNodeRChilds(roots.size());
                 for (std::uint64_t i = 0; i < roots.size(); i++)
                 {
-                    currNodeRChilds[i] = m_nodes[currNode.second[i]].rChild;
+                    currNodeRChilds[i] = nodes[currNode.second[i]].rChild;
                 }
                 currNode = { (currNode.first << 1) + 1, currNodeRChilds };
             }
@@ -224,7 +469,7 @@ public:
         std::vector<T> currVal(roots.size());
         for (std::uint64_t i = 0; i < roots.size(); i++)
         {
-            currVal[i] = T::calc(m_nodes[currNode.second[i]].data, cumulativeSuff[i]);
+            currVal[i] = T::calc(nodes[currNode.second[i]].data, cumulativeSuff[i]);
         }
 
         if (func(currVal))
@@ -235,17 +480,260 @@ public:
         return currNode.first - m_baseSize + 1;
     }
 
+    template <std::size_t K, typename Func>
+    std::int64_t leftBinSearch(const std::array<std::uint64_t, K>& roots, std::int64_t l, std::int64_t r, Func func) const
+    {
+        std::array<T, K> cumulativePref{};
+        std::int64_t failPos = this->leftBinSearchNode(roots, 0, m_baseSize - 1, l, r, func, cumulativePref);
+
+        return failPos == -1 ? r : failPos - 1;
+    }
+
+    template <std::size_t K, typename Func>
+    std::int64_t rightBinSearch(const std::array<std::uint64_t, K>& roots, std::int64_t l, std::int64_t r, Func func) const
+    {
+        std::array<T, K> cumulativeSuff{};
+        std::int64_t failPos = this->rightBinSearchNode(roots, 0, m_baseSize - 1, l, r, func, cumulativeSuff);
+
+        return failPos == -1 ? l : failPos + 1;
+    }
+
+    void save(const std::string& path) const
+    {
+        static_assert(std::is_trivially_copyable_v<Node>, "PersistentSegTree::save requires trivially copyable T");
+
+        FileHeader header{
+            m_fileMagic,
+            sizeof(Node),
+            m_baseSize,
+            m_initRoot,
+            this->getNodesCount(),
+            m_liveRoots.size()
+        };
+
+        std::string tempPath = path + ".tmp";
+
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(FileHeader));
+        NodesView nodes = this->getNodes();
+        for (std::uint64_t node = 0; node < header.nodesCount; node++)
+        {
+            out.write((const char*)&nodes[node], sizeof(Node));
+        }
+        out.write((const char*)m_liveRoots.data(), header.liveRootsCount * sizeof(std::uint64_t));
+        out.close();
+
+        std::error_code error{};
+        if (out)
+        {
+            std::filesystem::rename(tempPath, path, error);
+        }
+
+        if (!out || error)
+        {
+            std::filesystem::remove(tempPath, error);
+            throw std::runtime_error("PersistentSegTree: cannot write " + path);
+        }
+    }
+
+    static PersistentSegTree open(const std::string& path)
+    {
+        static_assert(std::is_trivially_copyable_v<Node>, "PersistentSegTree::open requires trivially copyable T");
+
+        PersistentSegTree tree{};
+
+        std::uint64_t fileSize = 0;
+        tree.m_mapping = PersistentSegTree::mapFile(path, fileSize);
+
+        const char* data = (const char*)tree.m_mapping.get();
+
+        FileHeader header{};
+        std::copy(data, data + sizeof(FileHeader), (char*)&header);
+
+        if (header.magic != m_fileMagic || header.nodeSize != sizeof(Node) ||
+            fileSize != sizeof(FileHeader) + header.nodesCount * sizeof(Node) + header.liveRootsCount * sizeof(std::uint64_t))
+        {
+            throw std::runtime_error("PersistentSegTree: invalid file " + path);
+        }
+
+        tree.m_baseSize = header.baseSize;
+        tree.m_initRoot = header.initRoot;
+        tree.m_mappedNodes = (const Node*)(data + sizeof(FileHeader));
+        tree.m_mappedNodesCount = header.nodesCount;
+
+        const char* liveRoots = data + sizeof(FileHeader) + header.nodesCount * sizeof(Node);
+        tree.m_liveRoots.resize(header.liveRootsCount);
+        std::copy(liveRoots, liveRoots + header.liveRootsCount * sizeof(std::uint64_t), (char*)tree.m_liveRoots.data());
+
+        tree.m_latestRoot.root.store(tree.m_liveRoots.empty() ? tree.m_initRoot : tree.m_liveRoots.back(), std::memory_order_release);
+
+        return tree;
+    }
+
 private:
     struct Node
     {
-        std::uint64_t lChild = std::numeric_limits<std::uint64_t>::max();
-        std::uint64_t rChild = std::numeric_limits<std::uint64_t>::max();
+        IndexType lChild = std::numeric_limits<IndexType>::max();
+        IndexType rChild = std::numeric_limits<IndexType>::max();
         T data{};
     };
 
+    struct FileHeader
+    {
+        std::uint64_t magic = 0;
+        std::uint64_t nodeSize = 0;
+        std::uint64_t baseSize = 0;
+        std::uint64_t initRoot = 0;
+        std::uint64_t nodesCount = 0;
+        std::uint64_t liveRootsCount = 0;
+        std::uint64_t reserved[2]{};
+    };
+
+    static constexpr std::uint64_t m_fileMagic = 0x31304745535450ULL;
+
+    PersistentSegTree() :
+        m_baseSize{ 0 }
+    {
+    }
+
+    static std::shared_ptr<const void> mapFile(const std::string& path, std::uint64_t& fileSize)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("PersistentSegTree: cannot open " + path);
+        }
+
+        LARGE_INTEGER size{};
+        GetFileSizeEx(file, &size);
+        fileSize = size.QuadPart;
+
+        HANDLE mapping = fileSize >= sizeof(FileHeader) ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+
+        const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+
+        if (!data)
+        {
+            throw std::runtime_error("PersistentSegTree: cannot map " + path);
+        }
+
+        return std::shared_ptr<const void>(data, [](const void* ptr) { UnmapViewOfFile(ptr); });
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file == -1)
+        {
+            throw std::runtime_error("PersistentSegTree: cannot open " + path);
+        }
+
+        struct stat fileStat{};
+        fstat(file, &fileStat);
+        fileSize = fileStat.st_size;
+
+        void* data = fileSize >= sizeof(FileHeader) ? mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+        close(file);
+
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("PersistentSegTree: cannot map " + path);
+        }
+
+        return std::shared_ptr<const void>(data, [fileSize](const void* ptr) { munmap((void*)ptr, fileSize); });
+#endif
+    }
+
+    using NodesStorage = std::conditional_t<isConcurrent, ChunkedVector<Node>, std::vector<Node>>;
+
+    struct ChunkedNodesView
+    {
+        const Node* mappedNodes;
+        std::uint64_t mappedNodesCount;
+        const ChunkedVector<Node>* nodes;
+
+        const Node& operator[](std::uint64_t node) const
+        {
+            return node < mappedNodesCount ? mappedNodes[node] : (*nodes)[node - mappedNodesCount];
+        }
+    };
+
+    using NodesView = std::conditional_t<isConcurrent, ChunkedNodesView, const Node*>;
+
+    struct AtomicRoot
+    {
+        AtomicRoot() = default;
+
+        AtomicRoot(const AtomicRoot& other) :
+            root{ other.root.load(std::memory_order_acquire) }
+        {
+        }
+
+        AtomicRoot& operator=(const AtomicRoot& other)
+        {
+            root.store(other.root.load(std::memory_order_acquire), std::memory_order_release);
+            return *this;
+        }
+
+        std::atomic<std::uint64_t> root = 0;
+    };
+
+    static void checkNodesCount(std::uint64_t nodesCount)
+    {
+        if (nodesCount > std::numeric_limits<IndexType>::max())
+        {
+            throw std::runtime_error("PersistentSegTree: node count exceeds IndexType range");
+        }
+    }
+
+    NodesView getNodes() const
+    {
+        if constexpr (isConcurrent)
+        {
+            return ChunkedNodesView{ m_mappedNodes, m_mappedNodesCount, &m_nodes };
+        }
+        else
+        {
+            return m_mapping ? m_mappedNodes : m_nodes.data();
+        }
+    }
+
+    std::uint64_t getNodesCount() const
+    {
+        return m_mappedNodesCount + m_nodes.size();
+    }
+
+    void detach()
+    {
+        if (!m_mapping)
+        {
+            return;
+        }
+
+        NodesStorage nodes{};
+        nodes.reserve(this->getNodesCount());
+        for (std::uint64_t node = 0; node < m_mappedNodesCount; node++)
+        {
+            nodes.push_back(m_mappedNodes[node]);
+        }
+        for (std::uint64_t node = 0; node < m_nodes.size(); node++)
+        {
+            nodes.push_back(m_nodes[node]);
+        }
+        m_nodes = std::move(nodes);
+
+        m_mapping.reset();
+        m_mappedNodes = nullptr;
+        m_mappedNodesCount = 0;
+    }
+
     std::uint64_t init(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t maxR)
     {
         std::uint64_t curr = m_nodes.size();
+        PersistentSegTree::checkNodesCount(curr + 1);
         m_nodes.push_back(Node{});
 
         if (maxR < lRange)
@@ -260,8 +748,8 @@ private:
             std::uint64_t l = init(lRange, mid, maxR);
             std::uint64_t r = init(mid + 1, rRange, maxR);
 
-            m_nodes[curr].lChild = l;
-            m_nodes[curr].rChild = r;
+            m_nodes[curr].lChild = (IndexType)l;
+            m_nodes[curr].rChild = (IndexType)r;
         }
         return curr;
     }
@@ -269,6 +757,7 @@ private:
     std::uint64_t init(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t maxR, const std::vector<T>& elems)
     {
         std::uint64_t curr = m_nodes.size();
+        PersistentSegTree::checkNodesCount(curr + 1);
         m_nodes.push_back(Node{});
 
         if (maxR < lRange)
@@ -283,8 +772,8 @@ private:
             std::uint64_t l = init(lRange, mid, maxR, elems);
             std::uint64_t r = init(mid + 1, rRange, maxR, elems);
 
-            m_nodes[curr].lChild = l;
-            m_nodes[curr].rChild = r;
+            m_nodes[curr].lChild = (IndexType)l;
+            m_nodes[curr].rChild = (IndexType)r;
 
             m_nodes[curr].data = T::calc(
                 m_nodes[l].data,
@@ -300,9 +789,11 @@ private:
 
     T queryNode(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r) const
     {
+        NodesView nodes = this->getNodes();
+
         if (l <= lRange && rRange <= r)
         {
-            return m_nodes[node].data;
+            return nodes[node].data;
         }
 
         if (rRange < l || r < lRange)
@@ -313,70 +804,299 @@ private:
         std::uint64_t mid = (lRange + rRange) >> 1;
 
         return T::calc(
-            queryNode(m_nodes[node].lChild, lRange, mid, l, r),
-            queryNode(m_nodes[node].rChild, mid + 1, rRange, l, r)
+            queryNode(nodes[node].lChild, lRange, mid, l, r),
+            queryNode(nodes[node].rChild, mid + 1, rRange, l, r)
         );
     }
 
-    std::uint64_t updateNode(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, const std::vector<std::pair<std::uint64_t, T>>& changes)
+    static std::vector<std::pair<std::uint64_t, T>> getSortedChanges(const std::vector<std::pair<std::uint64_t, T>>& changes)
     {
-        std::uint64_t newNodeIdx = m_nodes.size();
-        m_nodes.push_back(Node{});
+        std::vector<std::pair<std::uint64_t, T>> sortedChanges = changes;
+        std::stable_sort(sortedChanges.begin(), sortedChanges.end(), [](const std::pair<std::uint64_t, T>& left, const std::pair<std::uint64_t, T>& right)
+            {
+                return left.first < right.first;
+            });
+
+        return sortedChanges;
+    }
+
+    static bool isSortedChanges(const std::vector<std::pair<std::uint64_t, T>>& changes)
+    {
+        return std::is_sorted(changes.begin(), changes.end(), [](const std::pair<std::uint64_t, T>& left, const std::pair<std::uint64_t, T>& right)
+            {
+                return left.first < right.first;
+            });
+    }
+
+    static std::uint64_t splitChanges(const std::vector<std::pair<std::uint64_t, T>>& changes, std::uint64_t begin, std::uint64_t end, std::uint64_t mid)
+    {
+        return std::partition_point(changes.begin() + begin, changes.begin() + end, [mid](const std::pair<std::uint64_t, T>& change)
+            {
+                return change.first <= mid;
+            }) - changes.begin();
+    }
+
+    template <typename Buffer>
+    std::uint64_t updateNode(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, const std::vector<std::pair<std::uint64_t, T>>& changes,
+        std::uint64_t begin, std::uint64_t end, Buffer& buffer, std::uint64_t bufferStart)
+    {
+        std::uint64_t newNodeIdx = buffer.size();
+        PersistentSegTree::checkNodesCount(bufferStart + newNodeIdx + 1);
+        buffer.push_back(Node{});
 
         if (lRange == rRange)
         {
-            m_nodes[newNodeIdx].data = changes.back().second;
-            return newNodeIdx;
+            buffer[newNodeIdx].data = changes[end - 1].second;
+            return bufferStart + newNodeIdx;
         }
 
         std::uint64_t mid = (lRange + rRange) >> 1;
+        std::uint64_t split = PersistentSegTree::splitChanges(changes, begin, end, mid);
 
-        std::vector<std::pair<std::uint64_t, T>> lChanges{};
-        std::vector<std::pair<std::uint64_t, T>> rChanges{};
+        NodesView nodes = this->getNodes();
+        std::uint64_t l = nodes[node].lChild;
+        std::uint64_t r = nodes[node].rChild;
 
-        for (const std::pair<std::uint64_t, T>& change : changes)
+        if (begin < split)
+        {
+            l = updateNode(l, lRange, mid, changes, begin, split, buffer, bufferStart);
+        }
+        if (split < end)
+        {
+            r = updateNode(r, mid + 1, rRange, changes, split, end, buffer, bufferStart);
+        }
+
+        buffer[newNodeIdx].lChild = (IndexType)l;
+        buffer[newNodeIdx].rChild = (IndexType)r;
+
+        nodes = this->getNodes();
+        buffer[newNodeIdx].data = T::calc(
+            l < bufferStart ? nodes[l].data : buffer[l - bufferStart].data,
+            r < bufferStart ? nodes[r].data : buffer[r - bufferStart].data
+        );
+
+        return bufferStart + newNodeIdx;
+    }
+
+    void launchParallelTasks(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, const std::vector<std::pair<std::uint64_t, T>>& changes,
+        std::uint64_t begin, std::uint64_t end, std::uint64_t depth, std::vector<std::future<std::pair<std::vector<Node>, std::uint64_t>>>& tasks)
+    {
+        if (!depth || lRange == rRange)
+        {
+            tasks.push_back(std::async(std::launch::async, [this, node, lRange, rRange, &changes, begin, end]()
+                {
+                    std::vector<Node> buffer{};
+                    std::uint64_t root = this->updateNode(node, lRange, rRange, changes, begin, end, buffer, this->getNodesCount());
+
+                    return std::pair<std::vector<Node>, std::uint64_t>{ std::move(buffer), root };
+                }));
+            return;
+        }
+
+        NodesView nodes = this->getNodes();
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+        std::uint64_t split = PersistentSegTree::splitChanges(changes, begin, end, mid);
+
+        if (begin < split)
+        {
+            this->launchParallelTasks(nodes[node].lChild, lRange, mid, changes, begin, split, depth - 1, tasks);
+        }
+        if (split < end)
         {
-            if (change.first <= mid)
+            this->launchParallelTasks(nodes[node].rChild, mid + 1, rRange, changes, split, end, depth - 1, tasks);
+        }
+    }
+
+    std::uint64_t joinParallelTasks(std::uint64_t node, std::uint64_t lRange, std::uint64_t rRange, const std::vector<std::pair<std::uint64_t, T>>& changes,
+        std::uint64_t begin, std::uint64_t end, std::uint64_t depth, const std::vector<std::uint64_t>& tasksRoots, std::uint64_t& currTask)
+    {
+        if (!depth || lRange == rRange)
+        {
+            return tasksRoots[currTask++];
+        }
+
+        NodesView nodes = this->getNodes();
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+        std::uint64_t split = PersistentSegTree::splitChanges(changes, begin, end, mid);
+
+        std::uint64_t l = nodes[node].lChild;
+        std::uint64_t r = nodes[node].rChild;
+
+        if (begin < split)
+        {
+            l = this->joinParallelTasks(l, lRange, mid, changes, begin, split, depth - 1, tasksRoots, currTask);
+        }
+        if (split < end)
+        {
+            r = this->joinParallelTasks(r, mid + 1, rRange, changes, split, end, depth - 1, tasksRoots, currTask);
+        }
+
+        nodes = this->getNodes();
+
+        std::uint64_t newNodeIdx = this->getNodesCount();
+        PersistentSegTree::checkNodesCount(newNodeIdx + 1);
+        m_nodes.push_back(Node{ (IndexType)l, (IndexType)r, T::calc(nodes[l].data, nodes[r].data) });
+
+        return newNodeIdx;
+    }
+
+    template <std::size_t K, typename Func>
+    std::int64_t leftBinSearchNode(std::array<std::uint64_t, K> currNodes, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r,
+        Func& func, std::array<T, K>& cumulativePref) const
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
+        {
+            return -1;
+        }
+
+        NodesView nodes = this->getNodes();
+
+        std::array<T, K> currVal;
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
+        {
+            for (std::size_t i = 0; i < K; i++)
             {
-                lChanges.push_back(change);
+                currVal[i] = T::calc(cumulativePref[i], nodes[currNodes[i]].data);
             }
-            else
+            if (func(currVal))
+            {
+                cumulativePref = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
             {
-                rChanges.push_back(change);
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                for (std::size_t i = 0; i < K; i++)
+                {
+                    currVal[i] = T::calc(cumulativePref[i], nodes[nodes[currNodes[i]].lChild].data);
+                }
+
+                if (func(currVal))
+                {
+                    cumulativePref = currVal;
+                    for (std::size_t i = 0; i < K; i++)
+                    {
+                        currNodes[i] = nodes[currNodes[i]].rChild;
+                    }
+                    lRange = mid + 1;
+                }
+                else
+                {
+                    for (std::size_t i = 0; i < K; i++)
+                    {
+                        currNodes[i] = nodes[currNodes[i]].lChild;
+                    }
+                    rRange = mid;
+                }
             }
+
+            return lRange;
         }
 
-        if (lChanges.size())
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        std::array<std::uint64_t, K> lChilds;
+        std::array<std::uint64_t, K> rChilds;
+        for (std::size_t i = 0; i < K; i++)
         {
-            std::uint64_t l = updateNode(m_nodes[node].lChild, lRange, mid, lChanges);
-            m_nodes[newNodeIdx].lChild = l;
+            lChilds[i] = nodes[currNodes[i]].lChild;
+            rChilds[i] = nodes[currNodes[i]].rChild;
         }
-        else
+
+        std::int64_t failPos = this->leftBinSearchNode(lChilds, lRange, mid, l, r, func, cumulativePref);
+        if (failPos != -1)
         {
-            m_nodes[newNodeIdx].lChild = m_nodes[node].lChild;
+            return failPos;
         }
 
-        if (rChanges.size())
+        return this->leftBinSearchNode(rChilds, mid + 1, rRange, l, r, func, cumulativePref);
+    }
+
+    template <std::size_t K, typename Func>
+    std::int64_t rightBinSearchNode(std::array<std::uint64_t, K> currNodes, std::uint64_t lRange, std::uint64_t rRange, std::int64_t l, std::int64_t r,
+        Func& func, std::array<T, K>& cumulativeSuff) const
+    {
+        if ((std::int64_t)rRange < l || r < (std::int64_t)lRange)
         {
-            std::uint64_t r = updateNode(m_nodes[node].rChild, mid + 1, rRange, rChanges);
-            m_nodes[newNodeIdx].rChild = r;
+            return -1;
         }
-        else
+
+        NodesView nodes = this->getNodes();
+
+        std::array<T, K> currVal;
+
+        if (l <= (std::int64_t)lRange && (std::int64_t)rRange <= r)
         {
-            m_nodes[newNodeIdx].rChild = m_nodes[node].rChild;
+            for (std::size_t i = 0; i < K; i++)
+            {
+                currVal[i] = T::calc(nodes[currNodes[i]].data, cumulativeSuff[i]);
+            }
+            if (func(currVal))
+            {
+                cumulativeSuff = currVal;
+                return -1;
+            }
+
+            while (lRange != rRange)
+            {
+                std::uint64_t mid = (lRange + rRange) >> 1;
+
+                for (std::size_t i = 0; i < K; i++)
+                {
+                    currVal[i] = T::calc(nodes[nodes[currNodes[i]].rChild].data, cumulativeSuff[i]);
+                }
+
+                if (func(currVal))
+                {
+                    cumulativeSuff = currVal;
+                    for (std::size_t i = 0; i < K; i++)
+                    {
+                        currNodes[i] = nodes[currNodes[i]].lChild;
+                    }
+                    rRange = mid;
+                }
+                else
+                {
+                    for (std::size_t i = 0; i < K; i++)
+                    {
+                        currNodes[i] = nodes[currNodes[i]].rChild;
+                    }
+                    lRange = mid + 1;
+                }
+            }
+
+            return lRange;
         }
 
-        m_nodes[newNodeIdx].data = T::calc(
-            m_nodes[m_nodes[newNodeIdx].lChild].data,
-            m_nodes[m_nodes[newNodeIdx].rChild].data
-        );
+        std::uint64_t mid = (lRange + rRange) >> 1;
 
-        return newNodeIdx;
+        std::array<std::uint64_t, K> lChilds;
+        std::array<std::uint64_t, K> rChilds;
+        for (std::size_t i = 0; i < K; i++)
+        {
+            lChilds[i] = nodes[currNodes[i]].lChild;
+            rChilds[i] = nodes[currNodes[i]].rChild;
+        }
+
+        std::int64_t failPos = this->rightBinSearchNode(rChilds, mid + 1, rRange, l, r, func, cumulativeSuff);
+        if (failPos != -1)
+        {
+            return failPos;
+        }
+
+        return this->rightBinSearchNode(lChilds, lRange, mid, l, r, func, cumulativeSuff);
     }
 
     void getParts(std::uint64_t node, std::uint64_t startPos, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r,
         std::vector<std::pair<std::uint64_t, std::uint64_t>>& partsRootsIndexes) const
     {
+        NodesView nodes = this->getNodes();
+
         if (l <= lRange && rRange <= r)
         {
             partsRootsIndexes.push_back(std::pair<std::uint64_t, std::uint64_t>{ startPos, node });
@@ -390,12 +1110,19 @@ private:
 
         std::uint64_t mid = (lRange + rRange) >> 1;
 
-        getParts(m_nodes[node].lChild, startPos << 1, lRange, mid, l, r, partsRootsIndexes);
-        getParts(m_nodes[node].rChild, (startPos << 1) + 1, mid + 1, rRange, l, r, partsRootsIndexes);
+        getParts(nodes[node].lChild, startPos << 1, lRange, mid, l, r, partsRootsIndexes);
+        getParts(nodes[node].rChild, (startPos << 1) + 1, mid + 1, rRange, l, r, partsRootsIndexes);
     }
 
     std::uint64_t m_baseSize;
-    std::vector<Node> m_nodes{};
+    NodesStorage m_nodes{};
+    std::uint64_t m_initRoot = 0;
+    std::vector<std::uint64_t> m_liveRoots{ 0 };
+    AtomicRoot m_latestRoot{};
+
+    std::shared_ptr<const void> m_mapping{};
+    const Node* m_mappedNodes = nullptr;
+    std::uint64_t m_mappedNodesCount = 0;
 };
 
 struct Sum
@@ -0,0 +1,759 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <atomic>
+
+#include "NodePool.h"
+
+template <typename T>
+class PersistentTreap
+{
+public:
+    PersistentTreap() = default;
+
+    explicit PersistentTreap(std::uint64_t seed) :
+        m_seed{ seed }
+    {
+    }
+
+    PersistentTreap(const PersistentTreap& treap) :
+        m_pool{ treap.m_pool },
+        m_root{ treap.m_root }
+    {
+        if (m_root)
+        {
+            m_pool->retain(m_root);
+        }
+    }
+
+    PersistentTreap& operator=(const PersistentTreap& treap)
+    {
+        if (this != &treap)
+        {
+            if (treap.m_root)
+            {
+                treap.m_pool->retain(treap.m_root);
+            }
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
+            m_pool = treap.m_pool;
+            m_root = treap.m_root;
+        }
+
+        return *this;
+    }
+
+    PersistentTreap(PersistentTreap&& treap) :
+        m_pool{ treap.m_pool },
+        m_root{ treap.m_root },
+        m_seed{ treap.m_seed }
+    {
+        treap.m_root = 0;
+    }
+
+    PersistentTreap& operator=(PersistentTreap&& treap)
+    {
+        if (this != &treap)
+        {
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
+            m_pool = treap.m_pool;
+            m_root = treap.m_root;
+            m_seed = treap.m_seed;
+
+            treap.m_root = 0;
+        }
+
+        return *this;
+    }
+
+    void insert(const T& val, std::uint64_t count = 1)
+    {
+        if (!count)
+        {
+            return;
+        }
+
+        m_root = this->insertNode(m_root, val, count, this->getPriority());
+    }
+
+    std::uint64_t erase(const T& val, std::uint64_t count = 1)
+    {
+        std::uint64_t erased = std::min(count, this->count(val));
+        if (!erased)
+        {
+            return 0;
+        }
+
+        m_root = this->eraseNode(m_root, val, erased);
+
+        return erased;
+    }
+
+    std::uint64_t count(const T& val) const
+    {
+        std::uint32_t node = m_root;
+        while (node && (*m_pool)[node].val.key != val.key)
+        {
+            node = val.key < (*m_pool)[node].val.key ? (*m_pool)[node].lChild : (*m_pool)[node].rChild;
+        }
+
+        return node ? (*m_pool)[node].weight : 0;
+    }
+
+    std::vector<T> getRange(std::uint64_t l, std::uint64_t r) const
+    {
+        std::vector<T> res{};
+
+        if (l > r || l >= this->size())
+        {
+            return res;
+        }
+        r = std::min(r, this->size() - 1);
+        res.reserve(r - l + 1);
+
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{};
+        std::uint32_t node = m_root;
+        std::uint64_t k = 0;
+        while (node)
+        {
+            const Node& currNode = (*m_pool)[node];
+            std::uint64_t currPos = k + (*m_pool)[currNode.lChild].count;
+
+            if (l >= currPos + currNode.weight)
+            {
+                k = currPos + currNode.weight;
+                node = currNode.rChild;
+                continue;
+            }
+
+            stack.push_back({ node, currPos });
+            if (l >= currPos)
+            {
+                break;
+            }
+            node = currNode.lChild;
+        }
+
+        while (!stack.empty() && stack.back().second <= r)
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            const Node& currNode = (*m_pool)[curr.first];
+            std::uint64_t first = std::max(l, curr.second);
+            std::uint64_t last = std::min(r, curr.second + currNode.weight - 1);
+            res.insert(res.end(), last - first + 1, currNode.val);
+
+            std::uint64_t rightK = curr.second + currNode.weight;
+            for (std::uint32_t child = currNode.rChild; child; child = (*m_pool)[child].lChild)
+            {
+                stack.push_back({ child, rightK + (*m_pool)[(*m_pool)[child].lChild].count });
+            }
+        }
+
+        return res;
+    }
+
+    T getKth(std::uint64_t k) const
+    {
+        if (k >= this->size())
+        {
+            return T{};
+        }
+
+        std::uint32_t node = m_root;
+        while (true)
+        {
+            const Node& currNode = (*m_pool)[node];
+            std::uint64_t leftCount = (*m_pool)[currNode.lChild].count;
+
+            if (k < leftCount)
+            {
+                node = currNode.lChild;
+            }
+            else if (k < leftCount + currNode.weight)
+            {
+                return currNode.val;
+            }
+            else
+            {
+                k -= leftCount + currNode.weight;
+                node = currNode.rChild;
+            }
+        }
+    }
+
+    T getRangeQuery(std::uint64_t l, std::uint64_t r) const
+    {
+        T res{};
+
+        if (l <= r)
+        {
+            this->getRangeQuery(m_root, 0, res, l, r);
+        }
+
+        return res;
+    }
+
+    std::uint64_t getDepth() const
+    {
+        if (!m_root)
+        {
+            return 0;
+        }
+
+        std::uint64_t depth = 0;
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{ { m_root, 1 } };
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            depth = std::max(depth, curr.second);
+
+            for (std::uint32_t child : { (*m_pool)[curr.first].lChild, (*m_pool)[curr.first].rChild })
+            {
+                if (child)
+                {
+                    stack.push_back({ child, curr.second + 1 });
+                }
+            }
+        }
+
+        return depth;
+    }
+
+    std::uint64_t size() const
+    {
+        return m_root ? (*m_pool)[m_root].count : (std::uint64_t)0;
+    }
+
+    T getNearestSmaller(const T& val) const
+    {
+        std::uint64_t rank = this->getRank<true>(val.key);
+
+        return this->getKth(rank ? rank - 1 : 0);
+    }
+
+    T getNearestBigger(const T& val) const
+    {
+        std::uint64_t rank = this->getRank<false>(val.key);
+
+        return this->getKth(rank < this->size() ? rank : this->size() - 1);
+    }
+
+    std::uint64_t getSmallestK(const T& val) const
+    {
+        return this->count(val) ? this->getRank<false>(val.key) : this->size();
+    }
+
+    std::uint64_t getBiggestK(const T& val) const
+    {
+        return this->count(val) ? this->getRank<true>(val.key) - 1 : this->size();
+    }
+
+    void unite(const PersistentTreap& treap)
+    {
+        if (!treap.m_root)
+        {
+            return;
+        }
+        if (!m_root)
+        {
+            *this = treap;
+            return;
+        }
+
+        std::uint32_t otherRoot = treap.m_root;
+        if (m_pool == treap.m_pool)
+        {
+            m_pool->retain(otherRoot);
+        }
+        else
+        {
+            otherRoot = this->importNodes(*treap.m_pool, otherRoot);
+        }
+
+        m_root = this->uniteNodes(m_root, otherRoot);
+    }
+
+    void clear()
+    {
+        if (m_root)
+        {
+            m_pool->release(m_root);
+            m_root = 0;
+        }
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        m_pool->reserve(nodesCount);
+    }
+
+    ~PersistentTreap()
+    {
+        if (m_root && m_pool.use_count() > 1)
+        {
+            m_pool->release(m_root);
+        }
+    }
+
+private:
+    struct Node
+    {
+        T val{};
+        std::uint64_t priority = 0;
+        std::uint64_t weight = 0;
+        std::uint64_t count = 0;
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+    };
+
+    static std::uint64_t getDefaultSeed()
+    {
+        static std::atomic<std::uint64_t> instancesCount{ 0 };
+
+        return PersistentTreap::mix(instancesCount.fetch_add(1, std::memory_order_relaxed));
+    }
+
+    static std::uint64_t mix(std::uint64_t val)
+    {
+        val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9;
+        val = (val ^ (val >> 27)) * 0x94D049BB133111EB;
+
+        return val ^ (val >> 31);
+    }
+
+    std::uint64_t getPriority()
+    {
+        m_seed += 0x9E3779B97F4A7C15;
+
+        return PersistentTreap::mix(m_seed);
+    }
+
+    void recalc(std::uint32_t node)
+    {
+        Node& currNode = (*m_pool)[node];
+
+        currNode.val = T::calc(T::calcMany(currNode.val, currNode.weight), T::calc((*m_pool)[currNode.lChild].val, (*m_pool)[currNode.rChild].val));
+        currNode.count = (*m_pool)[currNode.lChild].count + (*m_pool)[currNode.rChild].count + currNode.weight;
+    }
+
+    std::uint32_t makeExclusive(std::uint32_t node)
+    {
+        if (!m_pool->isShared(node))
+        {
+            return node;
+        }
+
+        std::uint32_t copy = m_pool->allocate();
+        (*m_pool)[copy] = (*m_pool)[node];
+
+        if ((*m_pool)[copy].lChild)
+        {
+            m_pool->retain((*m_pool)[copy].lChild);
+        }
+        if ((*m_pool)[copy].rChild)
+        {
+            m_pool->retain((*m_pool)[copy].rChild);
+        }
+
+        m_pool->release(node);
+
+        return copy;
+    }
+
+    template <bool orEqual>
+    std::uint64_t getRank(const decltype(T::key)& key) const
+    {
+        std::uint64_t rank = 0;
+
+        std::uint32_t node = m_root;
+        while (node)
+        {
+            const Node& currNode = (*m_pool)[node];
+
+            if (currNode.val.key < key || (orEqual && currNode.val.key == key))
+            {
+                rank += (*m_pool)[currNode.lChild].count + currNode.weight;
+                node = currNode.rChild;
+            }
+            else
+            {
+                node = currNode.lChild;
+            }
+        }
+
+        return rank;
+    }
+
+    void getRangeQuery(std::uint32_t node, std::uint64_t k, T& res, std::uint64_t l, std::uint64_t r) const
+    {
+        if (!node || k > r || k + (*m_pool)[node].count <= l)
+        {
+            return;
+        }
+
+        const Node& currNode = (*m_pool)[node];
+
+        if (l <= k && k + currNode.count - 1 <= r)
+        {
+            res = T::calc(res, currNode.val);
+            return;
+        }
+
+        this->getRangeQuery(currNode.lChild, k, res, l, r);
+
+        std::uint64_t currPos = k + (*m_pool)[currNode.lChild].count;
+        std::uint64_t first = std::max(l, currPos);
+        std::uint64_t last = std::min(r, currPos + currNode.weight - 1);
+        if (first <= last)
+        {
+            res = T::calc(res, T::calcMany(currNode.val, last - first + 1));
+        }
+
+        this->getRangeQuery(currNode.rChild, currPos + currNode.weight, res, l, r);
+    }
+
+    std::uint32_t importNodes(const NodePool<Node>& otherPool, std::uint32_t otherRoot)
+    {
+        std::uint32_t root = m_pool->allocate();
+        (*m_pool)[root] = otherPool[otherRoot];
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack{ { otherRoot, root } };
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, std::uint32_t> curr = stack.back();
+            stack.pop_back();
+
+            std::uint32_t left = otherPool[curr.first].lChild ? m_pool->allocate() : 0;
+            std::uint32_t right = otherPool[curr.first].rChild ? m_pool->allocate() : 0;
+
+            if (left)
+            {
+                (*m_pool)[left] = otherPool[otherPool[curr.first].lChild];
+                stack.push_back({ otherPool[curr.first].lChild, left });
+            }
+            if (right)
+            {
+                (*m_pool)[right] = otherPool[otherPool[curr.first].rChild];
+                stack.push_back({ otherPool[curr.first].rChild, right });
+            }
+
+            (*m_pool)[curr.second].lChild = left;
+            (*m_pool)[curr.second].rChild = right;
+        }
+
+        return root;
+    }
+
+    void split(std::uint32_t node, const T& val, std::uint32_t& left, std::uint32_t& equal, std::uint32_t& right)
+    {
+        if (!node)
+        {
+            left = equal = right = 0;
+            return;
+        }
+
+        node = this->makeExclusive(node);
+        Node& currNode = (*m_pool)[node];
+
+        std::uint32_t temp = 0;
+        if (val.key < currNode.val.key)
+        {
+            this->split(currNode.lChild, val, left, equal, temp);
+            currNode.lChild = temp;
+            right = node;
+        }
+        else if (val.key > currNode.val.key)
+        {
+            this->split(currNode.rChild, val, temp, equal, right);
+            currNode.rChild = temp;
+            left = node;
+        }
+        else
+        {
+            left = currNode.lChild;
+            right = currNode.rChild;
+            equal = node;
+
+            currNode.lChild = 0;
+            currNode.rChild = 0;
+        }
+
+        this->recalc(node);
+    }
+
+    std::uint32_t mergeNodes(std::uint32_t left, std::uint32_t right)
+    {
+        if (!left || !right)
+        {
+            return left ? left : right;
+        }
+
+        if ((*m_pool)[left].priority > (*m_pool)[right].priority)
+        {
+            left = this->makeExclusive(left);
+            std::uint32_t merged = this->mergeNodes((*m_pool)[left].rChild, right);
+            (*m_pool)[left].rChild = merged;
+            this->recalc(left);
+
+            return left;
+        }
+
+        right = this->makeExclusive(right);
+        std::uint32_t merged = this->mergeNodes(left, (*m_pool)[right].lChild);
+        (*m_pool)[right].lChild = merged;
+        this->recalc(right);
+
+        return right;
+    }
+
+    std::uint32_t insertNode(std::uint32_t node, const T& val, std::uint64_t count, std::uint64_t priority)
+    {
+        if (!node || (*m_pool)[node].priority < priority)
+        {
+            std::uint32_t left = 0, equal = 0, right = 0;
+            this->split(node, val, left, equal, right);
+
+            if (equal)
+            {
+                (*m_pool)[equal].weight += count;
+                this->recalc(equal);
+
+                return this->mergeNodes(this->mergeNodes(left, equal), right);
+            }
+
+            std::uint32_t newNode = m_pool->allocate();
+            (*m_pool)[newNode] = Node{ val, priority, count, count, left, right };
+            this->recalc(newNode);
+
+            return newNode;
+        }
+
+        node = this->makeExclusive(node);
+        Node& currNode = (*m_pool)[node];
+
+        if (val.key == currNode.val.key)
+        {
+            currNode.weight += count;
+        }
+        else if (val.key < currNode.val.key)
+        {
+            std::uint32_t child = this->insertNode(currNode.lChild, val, count, priority);
+            currNode.lChild = child;
+        }
+        else
+        {
+            std::uint32_t child = this->insertNode(currNode.rChild, val, count, priority);
+            currNode.rChild = child;
+        }
+
+        this->recalc(node);
+
+        return node;
+    }
+
+    std::uint32_t eraseNode(std::uint32_t node, const T& val, std::uint64_t count)
+    {
+        node = this->makeExclusive(node);
+        Node& currNode = (*m_pool)[node];
+
+        if (val.key == currNode.val.key)
+        {
+            if (count < currNode.weight)
+            {
+                currNode.weight -= count;
+                this->recalc(node);
+
+                return node;
+            }
+
+            std::uint32_t merged = this->mergeNodes(currNode.lChild, currNode.rChild);
+            currNode.lChild = 0;
+            currNode.rChild = 0;
+            m_pool->release(node);
+
+            return merged;
+        }
+
+        if (val.key < currNode.val.key)
+        {
+            std::uint32_t child = this->eraseNode(currNode.lChild, val, count);
+            currNode.lChild = child;
+        }
+        else
+        {
+            std::uint32_t child = this->eraseNode(currNode.rChild, val, count);
+            currNode.rChild = child;
+        }
+
+        this->recalc(node);
+
+        return node;
+    }
+
+    std::uint32_t uniteNodes(std::uint32_t first, std::uint32_t second)
+    {
+        if (!first || !second)
+        {
+            return first ? first : second;
+        }
+
+        if ((*m_pool)[first].priority < (*m_pool)[second].priority)
+        {
+            std::swap(first, second);
+        }
+
+        first = this->makeExclusive(first);
+        Node& currNode = (*m_pool)[first];
+
+        std::uint32_t left = 0, equal = 0, right = 0;
+        this->split(second, currNode.val, left, equal, right);
+
+        if (equal)
+        {
+            currNode.weight += (*m_pool)[equal].weight;
+            m_pool->release(equal);
+        }
+
+        std::uint32_t leftChild = this->uniteNodes(currNode.lChild, left);
+        std::uint32_t rightChild = this->uniteNodes(currNode.rChild, right);
+        currNode.lChild = leftChild;
+        currNode.rChild = rightChild;
+        this->recalc(first);
+
+        return first;
+    }
+
+    std::shared_ptr<NodePool<Node>> m_pool = std::make_shared<NodePool<Node>>();
+    std::uint32_t m_root = 0;
+    std::uint64_t m_seed = PersistentTreap::getDefaultSeed();
+};
+
+struct Key
+{
+    Key() = default;
+
+    Key(std::int64_t val) :
+        key{ val }
+    {
+    }
+
+    std::int64_t key = 0;
+
+    static Key calc(const Key& firstKey, const Key& secondKey)
+    {
+        return Key(firstKey.key);
+    }
+
+    static Key calcMany(const Key& key, std::uint64_t count)
+    {
+        return Key(key.key);
+    }
+};
+
+struct Min
+{
+    Min() = default;
+
+    Min(std::int64_t val) :
+        key{ val },
+        min{ val }
+    {
+    }
+
+    Min(std::int64_t key, std::int64_t min) :
+        key{ key },
+        min{ min }
+    {
+    }
+
+    std::int64_t key = std::numeric_limits<std::int64_t>::max();
+
+    std::int64_t min = std::numeric_limits<std::int64_t>::max();
+
+    static Min calc(const Min& firstMin, const Min& secondMin)
+    {
+        return Min(firstMin.key, std::min(firstMin.min, secondMin.min));
+    }
+
+    static Min calcMany(const Min& min, std::uint64_t count)
+    {
+        return count ? Min(min.key) : Min{};
+    }
+};
+
+struct Max
+{
+    Max() = default;
+
+    Max(std::int64_t val) :
+        key{ val },
+        max{ val }
+    {
+    }
+
+    Max(std::int64_t key, std::int64_t max) :
+        key{ key },
+        max{ max }
+    {
+    }
+
+    std::int64_t key = std::numeric_limits<std::int64_t>::min();
+
+    std::int64_t max = std::numeric_limits<std::int64_t>::min();
+
+    static Max calc(const Max& firstMax, const Max& secondMax)
+    {
+        return Max(firstMax.key, std::max(firstMax.max, secondMax.max));
+    }
+
+    static Max calcMany(const Max& max, std::uint64_t count)
+    {
+        return count ? Max(max.key) : Max{};
+    }
+};
+
+struct Sum
+{
+    Sum() = default;
+
+    Sum(std::int64_t val) :
+        key{ val },
+        sum{ val }
+    {
+    }
+
+    Sum(std::int64_t key, std::int64_t sum) :
+        key{ key },
+        sum{ sum }
+    {
+    }
+
+    std::int64_t key = 0;
+
+    std::int64_t sum = 0;
+
+    static Sum calc(const Sum& firstSum, const Sum& secondSum)
+    {
+        return Sum(firstSum.key, firstSum.sum + secondSum.sum);
+    }
+
+    static Sum calcMany(const Sum& sum, std::uint64_t count)
+    {
+        return Sum(sum.key, sum.key * (std::int64_t)count);
+    }
+};
\ No newline at end of file
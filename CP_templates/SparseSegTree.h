@@ -6,6 +6,9 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <bit>
+
+#include "NodePool.h"
 
 template <typename T>
 class SparseSegTree
@@ -16,19 +19,47 @@ public:
     {
     }
 
+    SparseSegTree(const std::vector<std::uint64_t>& coords) :
+        m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(std::max(coords.size(), (std::size_t)1))) },
+        m_isCompressed{ true },
+        m_coords{ coords },
+        m_tree(m_baseSize << 1, T{})
+    {
+    }
+
     SparseSegTree(const SparseSegTree& tree) :
         m_baseSize{ tree.m_baseSize },
-        m_root{ tree.m_root ? new Node(*tree.m_root) : nullptr }
+        m_pool{ tree.m_pool },
+        m_root{ tree.m_root },
+        m_isCompressed{ tree.m_isCompressed },
+        m_coords{ tree.m_coords },
+        m_tree{ tree.m_tree }
     {
+        if (m_root)
+        {
+            m_pool->retain(m_root);
+        }
     }
 
     SparseSegTree& operator=(const SparseSegTree& tree)
     {
         if (this != &tree)
         {
-            delete m_root;
+            if (tree.m_root)
+            {
+                tree.m_pool->retain(tree.m_root);
+            }
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSize = tree.m_baseSize;
-            m_root = tree.m_root ? new Node(*tree.m_root) : nullptr;
+            m_pool = tree.m_pool;
+            m_root = tree.m_root;
+            m_isCompressed = tree.m_isCompressed;
+            m_coords = tree.m_coords;
+            m_tree = tree.m_tree;
         }
 
         return *this;
@@ -36,21 +67,32 @@ public:
 
     SparseSegTree(SparseSegTree&& tree) :
         m_baseSize{ tree.m_baseSize },
-        m_root{ tree.m_root }
+        m_pool{ std::move(tree.m_pool) },
+        m_root{ tree.m_root },
+        m_isCompressed{ tree.m_isCompressed },
+        m_coords{ std::move(tree.m_coords) },
+        m_tree{ std::move(tree.m_tree) }
     {
-        tree.m_baseSize = 0;
-        tree.m_root = nullptr;
+        tree.m_root = 0;
     }
 
     SparseSegTree& operator=(SparseSegTree&& tree)
     {
         if (this != &tree)
         {
-            delete m_root;
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSize = tree.m_baseSize;
+            m_pool = std::move(tree.m_pool);
             m_root = tree.m_root;
-            tree.m_baseSize = 0;
-            tree.m_root = nullptr;
+            m_isCompressed = tree.m_isCompressed;
+            m_coords = std::move(tree.m_coords);
+            m_tree = std::move(tree.m_tree);
+
+            tree.m_root = 0;
         }
 
         return *this;
@@ -58,23 +100,46 @@ public:
 
     T query(std::uint64_t l, std::uint64_t r) const
     {
-        return m_root ? m_root->query(0, m_baseSize - 1, l, r) : T{};
+        if (m_isCompressed)
+        {
+            return this->queryCompressed(l, r);
+        }
+
+        return m_root ? this->queryNode(m_root, 0, m_baseSize - 1, l, r) : T{};
     }
 
     void update(std::uint64_t pos, const T& val)
     {
-        if (!m_root)
+        if (m_isCompressed)
         {
-            m_root = new Node{};
+            this->updateCompressed(pos, val);
+            return;
         }
-        m_root->update(0, m_baseSize - 1, pos, val);
+
+        if (!m_pool)
+        {
+            m_pool = std::make_shared<NodePool<Node>>();
+        }
+
+        m_root = m_root ? this->makeExclusive(m_root) : m_pool->allocate();
+        this->updateNode(m_root, 0, m_baseSize - 1, pos, val);
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        if (!m_pool)
+        {
+            m_pool = std::make_shared<NodePool<Node>>();
+        }
+
+        m_pool->reserve(nodesCount);
     }
 
     ~SparseSegTree()
     {
-        if (m_root)
+        if (m_root && m_pool.use_count() > 1)
         {
-            delete m_root;
+            m_pool->release(m_root);
         }
     }
 
@@ -82,92 +147,141 @@ public:
     friend class SparseSegTree2d;
 
 private:
-    class Node
+    struct Node
+    {
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+        T data{};
+    };
+
+    SparseSegTree(std::uint64_t size, const std::shared_ptr<NodePool<Node>>& pool) :
+        m_baseSize{ (std::uint64_t)1 << (std::uint64_t)std::ceil(std::log2(size)) },
+        m_pool{ pool }
     {
-    public:
-        Node() = default;
+    }
 
-        Node(const Node& node) :
-            m_lChild{ node.m_lChild ? new Node(*node.m_lChild) : nullptr },
-            m_rChild{ node.m_rChild ? new Node(*node.m_rChild) : nullptr },
-            m_data{ node.m_data }
+    std::uint32_t makeExclusive(std::uint32_t node)
+    {
+        if (!m_pool->isShared(node))
         {
+            return node;
         }
 
-        T query(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r) const
+        std::uint32_t copy = m_pool->allocate();
+        (*m_pool)[copy] = (*m_pool)[node];
+
+        if ((*m_pool)[copy].lChild)
+        {
+            m_pool->retain((*m_pool)[copy].lChild);
+        }
+        if ((*m_pool)[copy].rChild)
+        {
+            m_pool->retain((*m_pool)[copy].rChild);
+        }
+
+        m_pool->release(node);
+
+        return copy;
+    }
+
+    T queryCompressed(std::uint64_t l, std::uint64_t r) const
+    {
+        std::uint64_t lPos = std::lower_bound(m_coords.begin(), m_coords.end(), l) - m_coords.begin();
+        std::uint64_t rPos = std::upper_bound(m_coords.begin(), m_coords.end(), r) - m_coords.begin();
+
+        T lRes{};
+        T rRes{};
+        for (lPos += m_baseSize, rPos += m_baseSize; lPos < rPos; lPos >>= 1, rPos >>= 1)
         {
-            if (l <= lRange && rRange <= r)
+            if (lPos & 1)
             {
-                return m_data;
+                lRes = T::calc(lRes, m_tree[lPos++]);
             }
-
-            if (rRange < l || r < lRange)
+            if (rPos & 1)
             {
-                return T{};
+                rRes = T::calc(m_tree[--rPos], rRes);
             }
+        }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+        return T::calc(lRes, rRes);
+    }
 
-            return T::calc(
-                m_lChild ? m_lChild->query(lRange, mid, l, r) : T{},
-                m_rChild ? m_rChild->query(mid + 1, rRange, l, r) : T{}
-            );
+    void updateCompressed(std::uint64_t pos, const T& val)
+    {
+        std::vector<std::uint64_t>::const_iterator it = std::lower_bound(m_coords.begin(), m_coords.end(), pos);
+        if (it == m_coords.end() || *it != pos)
+        {
+            return;
         }
 
-        void update(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t pos, const T& val)
+        std::uint64_t treePos = m_baseSize + (it - m_coords.begin());
+        m_tree[treePos] = val;
+
+        for (treePos >>= 1; treePos > 0; treePos >>= 1)
         {
-            if (lRange == rRange)
-            {
-                m_data = val;
+            m_tree[treePos] = T::calc(m_tree[treePos << 1], m_tree[(treePos << 1) + 1]);
+        }
+    }
 
-                return;
-            }
+    T queryNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t l, std::uint64_t r) const
+    {
+        const Node& currNode = (*m_pool)[node];
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+        if (l <= lRange && rRange <= r)
+        {
+            return currNode.data;
+        }
 
-            if (pos <= mid)
-            {
-                if (!m_lChild)
-                {
-                    m_lChild = new Node{};
-                }
-                m_lChild->update(lRange, mid, pos, val);
-            }
-            else
-            {
-                if (!m_rChild)
-                {
-                    m_rChild = new Node{};
-                }
-                m_rChild->update(mid + 1, rRange, pos, val);
-            }
+        if (rRange < l || r < lRange)
+        {
+            return T{};
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        return T::calc(
+            currNode.lChild ? this->queryNode(currNode.lChild, lRange, mid, l, r) : T{},
+            currNode.rChild ? this->queryNode(currNode.rChild, mid + 1, rRange, l, r) : T{}
+        );
+    }
 
-            m_data = T::calc(
-                m_lChild ? m_lChild->m_data : T{},
-                m_rChild ? m_rChild->m_data : T{}
-            );
+    void updateNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t pos, const T& val)
+    {
+        Node& currNode = (*m_pool)[node];
+
+        if (lRange == rRange)
+        {
+            currNode.data = val;
+
+            return;
         }
 
-        ~Node()
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        if (pos <= mid)
         {
-            if (m_lChild)
-            {
-                delete m_lChild;
-            }
-            if (m_rChild)
-            {
-                delete m_rChild;
-            }
+            currNode.lChild = currNode.lChild ? this->makeExclusive(currNode.lChild) : m_pool->allocate();
+            this->updateNode(currNode.lChild, lRange, mid, pos, val);
+        }
+        else
+        {
+            currNode.rChild = currNode.rChild ? this->makeExclusive(currNode.rChild) : m_pool->allocate();
+            this->updateNode(currNode.rChild, mid + 1, rRange, pos, val);
         }
 
-    private:
-        Node* m_lChild = nullptr;
-        Node* m_rChild = nullptr;
-        T m_data{};
-    };
+        currNode.data = T::calc(
+            currNode.lChild ? (*m_pool)[currNode.lChild].data : T{},
+            currNode.rChild ? (*m_pool)[currNode.rChild].data : T{}
+        );
+    }
 
     std::uint64_t m_baseSize;
-    Node* m_root = nullptr;
+    std::shared_ptr<NodePool<Node>> m_pool{};
+    std::uint32_t m_root = 0;
+
+    bool m_isCompressed = false;
+    std::vector<std::uint64_t> m_coords{};
+    std::vector<T> m_tree{};
 };
 
 template <typename T>
@@ -183,17 +297,34 @@ public:
     SparseSegTree2d(const SparseSegTree2d& tree) :
         m_baseSizeI{ tree.m_baseSizeI },
         m_baseSizeJ{ tree.m_baseSizeJ },
-        m_root{ tree.m_root ? new Node2d(*tree.m_root) : nullptr }
+        m_pool{ tree.m_pool },
+        m_innerPool{ tree.m_innerPool },
+        m_root{ tree.m_root }
     {
+        if (m_root)
+        {
+            m_pool->retain(m_root);
+        }
     }
 
     SparseSegTree2d& operator=(const SparseSegTree2d& tree)
     {
         if (this != &tree)
         {
+            if (tree.m_root)
+            {
+                tree.m_pool->retain(tree.m_root);
+            }
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSizeI = tree.m_baseSizeI;
             m_baseSizeJ = tree.m_baseSizeJ;
-            m_root = tree.m_root ? new Node2d(*tree.m_root) : nullptr;
+            m_pool = tree.m_pool;
+            m_innerPool = tree.m_innerPool;
+            m_root = tree.m_root;
         }
 
         return *this;
@@ -202,23 +333,29 @@ public:
     SparseSegTree2d(SparseSegTree2d&& tree) :
         m_baseSizeI{ tree.m_baseSizeI },
         m_baseSizeJ{ tree.m_baseSizeJ },
+        m_pool{ std::move(tree.m_pool) },
+        m_innerPool{ std::move(tree.m_innerPool) },
         m_root{ tree.m_root }
     {
-        tree.m_baseSizeI = 0;
-        tree.m_baseSizeJ = 0;
-        tree.m_root = nullptr;
+        tree.m_root = 0;
     }
 
     SparseSegTree2d& operator=(SparseSegTree2d&& tree)
     {
         if (this != &tree)
         {
+            if (m_root)
+            {
+                m_pool->release(m_root);
+            }
+
             m_baseSizeI = tree.m_baseSizeI;
             m_baseSizeJ = tree.m_baseSizeJ;
+            m_pool = std::move(tree.m_pool);
+            m_innerPool = std::move(tree.m_innerPool);
             m_root = tree.m_root;
-            tree.m_baseSizeI = 0;
-            tree.m_baseSizeJ = 0;
-            tree.m_root = nullptr;
+
+            tree.m_root = 0;
         }
 
         return *this;
@@ -226,117 +363,439 @@ public:
 
     T query(std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
     {
-        return m_root ? m_root->query(0, m_baseSizeI - 1, lI, rI, lJ, rJ) : T{};
+        return m_root ? this->queryNode(m_root, 0, m_baseSizeI - 1, lI, rI, lJ, rJ) : T{};
     }
 
     void update(std::uint64_t posI, std::uint64_t posJ, const T& val)
     {
-        if (!m_root)
+        if (!m_pool)
+        {
+            m_pool = std::make_shared<NodePool<Node2d>>();
+            m_innerPool = std::make_shared<NodePool<typename SparseSegTree<T>::Node>>();
+        }
+
+        m_root = m_root ? this->makeExclusive(m_root) : this->allocate();
+        this->updateNode(m_root, 0, m_baseSizeI - 1, posI, posJ, val);
+    }
+
+    void reserve(std::uint64_t nodesCount)
+    {
+        if (!m_pool)
         {
-            m_root = new Node2d(m_baseSizeJ);
+            m_pool = std::make_shared<NodePool<Node2d>>();
+            m_innerPool = std::make_shared<NodePool<typename SparseSegTree<T>::Node>>();
         }
-        m_root->update(0, m_baseSizeI - 1, posI, posJ, val);
+
+        m_pool->reserve(nodesCount);
     }
 
     ~SparseSegTree2d()
     {
-        if (m_root)
+        if (m_root && m_pool.use_count() > 1)
         {
-            delete m_root;
+            m_pool->release(m_root);
         }
     }
 
 private:
-    class Node2d
+    struct Node2d
     {
-    public:
-        Node2d(std::uint64_t baseSizeJ) :
-            m_data(baseSizeJ)
+        std::uint32_t lChild = 0;
+        std::uint32_t rChild = 0;
+        SparseSegTree<T> data{ 1 };
+    };
+
+    std::uint32_t allocate()
+    {
+        std::uint32_t node = m_pool->allocate();
+        (*m_pool)[node].data = SparseSegTree<T>(m_baseSizeJ, m_innerPool);
+
+        return node;
+    }
+
+    std::uint32_t makeExclusive(std::uint32_t node)
+    {
+        if (!m_pool->isShared(node))
         {
+            return node;
         }
 
-        Node2d(const Node2d& node) :
-            m_lChild{ node.m_lChild ? new Node2d(*node.m_lChild) : nullptr },
-            m_rChild{ node.m_rChild ? new Node2d(*node.m_rChild) : nullptr },
-            m_data{ node.m_data }
+        std::uint32_t copy = m_pool->allocate();
+        (*m_pool)[copy] = (*m_pool)[node];
+
+        if ((*m_pool)[copy].lChild)
         {
+            m_pool->retain((*m_pool)[copy].lChild);
         }
+        if ((*m_pool)[copy].rChild)
+        {
+            m_pool->retain((*m_pool)[copy].rChild);
+        }
+
+        m_pool->release(node);
+
+        return copy;
+    }
 
-        T query(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
+    T queryNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
+    {
+        const Node2d& currNode = (*m_pool)[node];
+
+        if (lI <= lRange && rRange <= rI)
         {
-            if (lI <= lRange && rRange <= rI)
-            {
-                return m_data.query(lJ, rJ);
-            }
+            return currNode.data.query(lJ, rJ);
+        }
 
-            if (rRange < lI || rI < lRange)
-            {
-                return T{};
-            }
+        if (rRange < lI || rI < lRange)
+        {
+            return T{};
+        }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        return T::calc(
+            currNode.lChild ? this->queryNode(currNode.lChild, lRange, mid, lI, rI, lJ, rJ) : T{},
+            currNode.rChild ? this->queryNode(currNode.rChild, mid + 1, rRange, lI, rI, lJ, rJ) : T{}
+        );
+    }
+
+    void updateNode(std::uint32_t node, std::uint64_t lRange, std::uint64_t rRange, std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        Node2d& currNode = (*m_pool)[node];
 
-            return T::calc(
-                m_lChild ? m_lChild->query(lRange, mid, lI, rI, lJ, rJ) : T{},
-                m_rChild ? m_rChild->query(mid + 1, rRange, lI, rI, lJ, rJ) : T{}
-            );
+        if (lRange == rRange)
+        {
+            currNode.data.update(posJ, val);
+
+            return;
+        }
+
+        std::uint64_t mid = (lRange + rRange) >> 1;
+
+        if (posI <= mid)
+        {
+            currNode.lChild = currNode.lChild ? this->makeExclusive(currNode.lChild) : this->allocate();
+            this->updateNode(currNode.lChild, lRange, mid, posI, posJ, val);
+        }
+        else
+        {
+            currNode.rChild = currNode.rChild ? this->makeExclusive(currNode.rChild) : this->allocate();
+            this->updateNode(currNode.rChild, mid + 1, rRange, posI, posJ, val);
         }
 
-        void update(std::uint64_t lRange, std::uint64_t rRange, std::uint64_t posI, std::uint64_t posJ, const T& val)
+        currNode.data.update(posJ, T::calc(
+            currNode.lChild ? (*m_pool)[currNode.lChild].data.query(posJ, posJ) : T{},
+            currNode.rChild ? (*m_pool)[currNode.rChild].data.query(posJ, posJ) : T{}
+        ));
+    }
+
+    std::uint64_t m_baseSizeI;
+    std::uint64_t m_baseSizeJ;
+    std::shared_ptr<NodePool<Node2d>> m_pool{};
+    std::shared_ptr<NodePool<typename SparseSegTree<T>::Node>> m_innerPool{};
+    std::uint32_t m_root = 0;
+};
+
+template <typename T>
+class OfflineSparseSegTree2d
+{
+public:
+    OfflineSparseSegTree2d(std::vector<std::pair<std::uint64_t, std::uint64_t>> points)
+    {
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+
+        m_points = points;
+        m_vals.assign(m_points.size(), T{});
+
+        for (const std::pair<std::uint64_t, std::uint64_t>& point : m_points)
         {
-            if (lRange == rRange)
+            if (m_coordsI.empty() || m_coordsI.back() != point.first)
             {
-                m_data.update(posJ, val);
+                m_coordsI.push_back(point.first);
+            }
+        }
 
-                return;
+        std::uint64_t sizeI = m_coordsI.size();
+        m_offsets.assign(sizeI + 2, 0);
+
+        for (std::uint64_t point = 0, rank = 0; point < m_points.size(); point++)
+        {
+            if (m_points[point].first != m_coordsI[rank])
+            {
+                rank++;
             }
+            for (std::uint64_t i = rank + 1; i <= sizeI; i += i & (~i + 1))
+            {
+                m_offsets[i + 1]++;
+            }
+        }
+        for (std::uint64_t i = 1; i <= sizeI + 1; i++)
+        {
+            m_offsets[i] += m_offsets[i - 1];
+        }
 
-            std::uint64_t mid = (lRange + rRange) >> 1;
+        m_coordsJ.resize(m_offsets[sizeI + 1]);
+        std::vector<std::uint64_t> filled(m_offsets.begin(), m_offsets.end() - 1);
 
-            if (posI <= mid)
+        for (std::uint64_t point = 0, rank = 0; point < m_points.size(); point++)
+        {
+            if (m_points[point].first != m_coordsI[rank])
             {
-                if (!m_lChild)
-                {
-                    m_lChild = new Node2d(m_data.m_baseSize);
-                }
-                m_lChild->update(lRange, mid, posI, posJ, val);
+                rank++;
             }
-            else
+            for (std::uint64_t i = rank + 1; i <= sizeI; i += i & (~i + 1))
             {
-                if (!m_rChild)
-                {
-                    m_rChild = new Node2d(m_data.m_baseSize);
-                }
-                m_rChild->update(mid + 1, rRange, posI, posJ, val);
+                m_coordsJ[filled[i]++] = m_points[point].second;
             }
+        }
+
+        std::uint64_t newSize = 0;
+        for (std::uint64_t i = 1; i <= sizeI; i++)
+        {
+            std::vector<std::uint64_t>::iterator begin = m_coordsJ.begin() + m_offsets[i];
+            std::vector<std::uint64_t>::iterator end = m_coordsJ.begin() + m_offsets[i + 1];
+
+            std::sort(begin, end);
+            end = std::unique(begin, end);
+
+            std::uint64_t offset = m_offsets[i];
+            m_offsets[i] = newSize;
+            if (newSize == offset)
+            {
+                newSize += end - begin;
+                continue;
+            }
+            newSize = std::move(begin, end, m_coordsJ.begin() + newSize) - m_coordsJ.begin();
+        }
+        m_offsets[sizeI + 1] = newSize;
+
+        m_coordsJ.resize(newSize);
+        m_coordsJ.shrink_to_fit();
+        m_tree.assign(newSize, T{});
+    }
+
+    T query(std::uint64_t lI, std::uint64_t rI, std::uint64_t lJ, std::uint64_t rJ) const
+    {
+        std::uint64_t rankL = std::lower_bound(m_coordsI.begin(), m_coordsI.end(), lI) - m_coordsI.begin();
+        std::uint64_t rankR = std::upper_bound(m_coordsI.begin(), m_coordsI.end(), rI) - m_coordsI.begin();
 
-            m_data.update(posJ, T::calc(
-                m_lChild ? m_lChild->m_data.query(posJ, posJ) : T{},
-                m_rChild ? m_rChild->m_data.query(posJ, posJ) : T{}
-            ));
+        if (rankL >= rankR)
+        {
+            return T{};
+        }
+
+        return T::calc(this->queryPref(rankR, lJ, rJ), T::calcInverse(this->queryPref(rankL, lJ, rJ)));
+    }
+
+    void update(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>>::const_iterator it = std::lower_bound(
+            m_points.begin(), m_points.end(), std::make_pair(posI, posJ)
+        );
+        if (it == m_points.end() || *it != std::make_pair(posI, posJ))
+        {
+            return;
         }
 
-        ~Node2d()
+        T& currVal = m_vals[it - m_points.begin()];
+        this->updateByPoint(posI, posJ, T::calc(val, T::calcInverse(currVal)));
+        currVal = val;
+    }
+
+    void updateBy(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>>::const_iterator it = std::lower_bound(
+            m_points.begin(), m_points.end(), std::make_pair(posI, posJ)
+        );
+        if (it == m_points.end() || *it != std::make_pair(posI, posJ))
         {
-            if (m_lChild)
+            return;
+        }
+
+        T& currVal = m_vals[it - m_points.begin()];
+        this->updateByPoint(posI, posJ, val);
+        currVal = T::calc(currVal, val);
+    }
+
+    T getElem(std::uint64_t posI, std::uint64_t posJ) const
+    {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>>::const_iterator it = std::lower_bound(
+            m_points.begin(), m_points.end(), std::make_pair(posI, posJ)
+        );
+
+        return it == m_points.end() || *it != std::make_pair(posI, posJ) ? T{} : m_vals[it - m_points.begin()];
+    }
+
+private:
+    void updateByPoint(std::uint64_t posI, std::uint64_t posJ, const T& val)
+    {
+        std::uint64_t sizeI = m_coordsI.size();
+        std::uint64_t rank = std::lower_bound(m_coordsI.begin(), m_coordsI.end(), posI) - m_coordsI.begin();
+
+        for (std::uint64_t i = rank + 1; i <= sizeI; i += i & (~i + 1))
+        {
+            std::uint64_t offset = m_offsets[i];
+            std::uint64_t size = m_offsets[i + 1] - offset;
+            std::uint64_t pos = std::lower_bound(m_coordsJ.begin() + offset, m_coordsJ.begin() + offset + size, posJ) - m_coordsJ.begin() - offset;
+
+            for (std::uint64_t j = pos + 1; j <= size; j += j & (~j + 1))
             {
-                delete m_lChild;
+                m_tree[offset + j - 1] = T::calc(m_tree[offset + j - 1], val);
             }
-            if (m_rChild)
+        }
+    }
+
+    T queryPref(std::uint64_t countI, std::uint64_t lJ, std::uint64_t rJ) const
+    {
+        T res{};
+        for (std::uint64_t i = countI; i > 0; i -= i & (~i + 1))
+        {
+            std::uint64_t offset = m_offsets[i];
+            std::uint64_t size = m_offsets[i + 1] - offset;
+
+            std::uint64_t countL = std::lower_bound(m_coordsJ.begin() + offset, m_coordsJ.begin() + offset + size, lJ) - m_coordsJ.begin() - offset;
+            std::uint64_t countR = std::upper_bound(m_coordsJ.begin() + offset, m_coordsJ.begin() + offset + size, rJ) - m_coordsJ.begin() - offset;
+
+            if (countL < countR)
             {
-                delete m_rChild;
+                res = T::calc(res, T::calc(this->queryPrefInner(offset, countR), T::calcInverse(this->queryPrefInner(offset, countL))));
             }
         }
 
-    private:
-        Node2d* m_lChild = nullptr;
-        Node2d* m_rChild = nullptr;
-        SparseSegTree<T> m_data;
+        return res;
+    }
+
+    T queryPrefInner(std::uint64_t offset, std::uint64_t countJ) const
+    {
+        T res{};
+        for (std::uint64_t j = countJ; j > 0; j -= j & (~j + 1))
+        {
+            res = T::calc(res, m_tree[offset + j - 1]);
+        }
+
+        return res;
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> m_points{};
+    std::vector<T> m_vals{};
+    std::vector<std::uint64_t> m_coordsI{};
+    std::vector<std::uint64_t> m_offsets{};
+    std::vector<std::uint64_t> m_coordsJ{};
+    std::vector<T> m_tree{};
+};
+
+template <typename T>
+class RadixSparseSegTree
+{
+public:
+    RadixSparseSegTree() = default;
+
+    T query(std::uint64_t l, std::uint64_t r) const
+    {
+        return m_nodes.empty() ? T{} : this->queryNode(m_root, l, r);
+    }
+
+    void update(std::uint64_t pos, const T& val)
+    {
+        if (m_nodes.empty())
+        {
+            m_root = this->addNode(Node{ pos, 0, 0, 0, val });
+            return;
+        }
+
+        m_root = this->updateNode(m_root, pos, val);
+    }
+
+    void reserve(std::uint64_t keysCount)
+    {
+        m_nodes.reserve(keysCount ? (keysCount << 1) - 1 : 0);
+    }
+
+private:
+    struct Node
+    {
+        std::uint64_t key;
+        std::uint8_t level;
+        std::uint32_t lChild;
+        std::uint32_t rChild;
+        T data;
     };
 
-    std::uint64_t m_baseSizeI;
-    std::uint64_t m_baseSizeJ;
-    Node2d* m_root = nullptr;
+    std::uint32_t addNode(const Node& node)
+    {
+        m_nodes.push_back(node);
+        return (std::uint32_t)m_nodes.size() - 1;
+    }
+
+    std::uint64_t getRangeEnd(const Node& node) const
+    {
+        return node.level == 64 ? std::numeric_limits<std::uint64_t>::max() : node.key + (((std::uint64_t)1 << node.level) - 1);
+    }
+
+    T queryNode(std::uint32_t node, std::uint64_t l, std::uint64_t r) const
+    {
+        const Node& currNode = m_nodes[node];
+        std::uint64_t lRange = currNode.key;
+        std::uint64_t rRange = this->getRangeEnd(currNode);
+
+        if (rRange < l || r < lRange)
+        {
+            return T{};
+        }
+
+        if (l <= lRange && rRange <= r)
+        {
+            return currNode.data;
+        }
+
+        return T::calc(
+            this->queryNode(currNode.lChild, l, r),
+            this->queryNode(currNode.rChild, l, r)
+        );
+    }
+
+    std::uint32_t updateNode(std::uint32_t node, std::uint64_t pos, const T& val)
+    {
+        if (pos < m_nodes[node].key || this->getRangeEnd(m_nodes[node]) < pos)
+        {
+            std::uint32_t leaf = this->addNode(Node{ pos, 0, 0, 0, val });
+
+            std::uint8_t level = (std::uint8_t)std::bit_width(m_nodes[node].key ^ pos);
+            std::uint64_t key = level == 64 ? 0 : pos & ~(((std::uint64_t)1 << level) - 1);
+
+            if (pos < m_nodes[node].key)
+            {
+                return this->addNode(Node{ key, level, leaf, node, T::calc(m_nodes[leaf].data, m_nodes[node].data) });
+            }
+
+            return this->addNode(Node{ key, level, node, leaf, T::calc(m_nodes[node].data, m_nodes[leaf].data) });
+        }
+
+        if (!m_nodes[node].level)
+        {
+            m_nodes[node].data = val;
+            return node;
+        }
+
+        if ((pos >> (m_nodes[node].level - 1)) & 1)
+        {
+            std::uint32_t child = this->updateNode(m_nodes[node].rChild, pos, val);
+            m_nodes[node].rChild = child;
+        }
+        else
+        {
+            std::uint32_t child = this->updateNode(m_nodes[node].lChild, pos, val);
+            m_nodes[node].lChild = child;
+        }
+
+        m_nodes[node].data = T::calc(m_nodes[m_nodes[node].lChild].data, m_nodes[m_nodes[node].rChild].data);
+
+        return node;
+    }
+
+    std::vector<Node> m_nodes{};
+    std::uint32_t m_root = 0;
 };
 
 struct Sum
@@ -347,6 +806,11 @@ struct Sum
     {
         return Sum{ left.val + right.val };
     }
+
+    static Sum calcInverse(const Sum& sum)
+    {
+        return Sum{ -sum.val };
+    }
 };
 
 struct Min
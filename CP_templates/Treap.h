@@ -3,6 +3,12 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <atomic>
+#include <iterator>
+#include <future>
+#include <bit>
+
+#include "NodePool.h"
 
 template <typename T>
 class Treap
@@ -10,8 +16,14 @@ class Treap
 public:
     Treap() = default;
 
+    explicit Treap(std::uint64_t seed) :
+        m_seed{ seed }
+    {
+    }
+
     Treap(const Treap& treap) :
-        m_root{ treap.m_root ? new Node(*treap.m_root) : nullptr }
+        m_pool{ treap.m_pool },
+        m_root{ treap.m_root }
     {
     }
 
@@ -19,31 +31,89 @@ public:
     {
         if (this != &treap)
         {
-            delete m_root;
-            m_root = treap.m_root ? new Node(*treap.m_root) : nullptr;
+            m_pool = treap.m_pool;
+            m_root = treap.m_root;
         }
 
         return *this;
     }
 
     Treap(Treap&& treap) :
-        m_root{ treap.m_root }
+        m_pool{ std::move(treap.m_pool) },
+        m_root{ treap.m_root },
+        m_seed{ treap.m_seed }
     {
-        treap.m_root = nullptr;
+        treap.m_pool.clear();
+        treap.m_root = 0;
     }
 
     Treap& operator=(Treap&& treap)
     {
         if (this != &treap)
         {
-            delete m_root;
+            m_pool = std::move(treap.m_pool);
             m_root = treap.m_root;
-            treap.m_root = nullptr;
+            m_seed = treap.m_seed;
+
+            treap.m_pool.clear();
+            treap.m_root = 0;
         }
 
         return *this;
     }
 
+    template <typename Iterator>
+    Treap(Iterator begin, Iterator end)
+    {
+        this->assignSorted(begin, end);
+    }
+
+    template <typename Iterator>
+    void assignSorted(Iterator begin, Iterator end)
+    {
+        m_pool.clear();
+        m_pool.reserve(std::distance(begin, end));
+        m_root = 0;
+
+        std::vector<std::uint32_t> stack{};
+        while (begin != end)
+        {
+            Iterator runEnd = begin;
+            std::uint64_t weight = 0;
+            while (runEnd != end && (*runEnd).key == (*begin).key)
+            {
+                ++runEnd;
+                weight++;
+            }
+
+            std::uint32_t node = m_pool.allocate(Node{ *begin, this->getPriority(), weight, weight });
+
+            std::uint32_t last = 0;
+            while (!stack.empty() && m_pool[stack.back()].priority < m_pool[node].priority)
+            {
+                last = stack.back();
+                stack.pop_back();
+                this->recalc(last);
+            }
+
+            m_pool[node].left = last;
+            if (!stack.empty())
+            {
+                m_pool[stack.back()].right = node;
+            }
+            stack.push_back(node);
+
+            begin = runEnd;
+        }
+
+        while (!stack.empty())
+        {
+            m_root = stack.back();
+            stack.pop_back();
+            this->recalc(m_root);
+        }
+    }
+
     void insert(const T& val, std::uint64_t count = 1)
     {
         if (!count)
@@ -51,12 +121,77 @@ public:
             return;
         }
 
-        m_root = this->insert(m_root, val, count);
+        std::uint64_t priority = this->getPriority();
+
+        m_path.clear();
+
+        std::uint32_t parent = 0;
+        std::uint32_t node = m_root;
+        while (node && m_pool[node].priority >= priority && m_pool[node].val.key != val.key)
+        {
+            m_path.push_back(node);
+            parent = node;
+            node = val.key < m_pool[node].val.key ? m_pool[node].left : m_pool[node].right;
+        }
+
+        std::uint64_t attachDepth = m_path.size();
+
+        std::uint32_t existing = node;
+        while (existing && m_pool[existing].val.key != val.key)
+        {
+            m_path.push_back(existing);
+            existing = val.key < m_pool[existing].val.key ? m_pool[existing].left : m_pool[existing].right;
+        }
+
+        if (existing)
+        {
+            m_pool[existing].weight += count;
+            m_path.push_back(existing);
+            this->recalcPath();
+
+            return;
+        }
+
+        m_path.resize(attachDepth);
+
+        std::uint32_t newNode = m_pool.allocate(Node{ T::calcMany(val, count), priority, count, count });
+        m_path.push_back(newNode);
+
+        std::uint32_t* leftHook = &m_pool[newNode].left;
+        std::uint32_t* rightHook = &m_pool[newNode].right;
+        while (node)
+        {
+            m_path.push_back(node);
+
+            if (m_pool[node].val.key < val.key)
+            {
+                *leftHook = node;
+                leftHook = &m_pool[node].right;
+                node = m_pool[node].right;
+            }
+            else
+            {
+                *rightHook = node;
+                rightHook = &m_pool[node].left;
+                node = m_pool[node].left;
+            }
+        }
+        *leftHook = 0;
+        *rightHook = 0;
+
+        this->setChild(parent, val, newNode);
+        this->recalcPath();
     }
 
     std::uint64_t count(const T& val) const
     {
-        return this->count(m_root, val);
+        std::uint32_t node = m_root;
+        while (node && m_pool[node].val.key != val.key)
+        {
+            node = val.key < m_pool[node].val.key ? m_pool[node].left : m_pool[node].right;
+        }
+
+        return node ? m_pool[node].weight : 0;
     }
 
     std::uint64_t erase(const T& val, std::uint64_t count = 1)
@@ -66,60 +201,268 @@ public:
             return 0;
         }
 
-        std::pair<Node*, std::uint64_t> data = this->erase(m_root, val, count);
-        m_root = data.first;
+        m_path.clear();
+
+        std::uint32_t parent = 0;
+        std::uint32_t node = m_root;
+        while (node && m_pool[node].val.key != val.key)
+        {
+            m_path.push_back(node);
+            parent = node;
+            node = val.key < m_pool[node].val.key ? m_pool[node].left : m_pool[node].right;
+        }
 
-        return data.second;
+        if (!node)
+        {
+            return 0;
+        }
+
+        if (count < m_pool[node].weight)
+        {
+            m_pool[node].weight -= count;
+            m_path.push_back(node);
+            this->recalcPath();
+
+            return count;
+        }
+
+        std::uint64_t weight = m_pool[node].weight;
+        std::uint32_t left = m_pool[node].left;
+        std::uint32_t right = m_pool[node].right;
+
+        std::uint32_t merged = 0;
+        std::uint32_t* hook = &merged;
+        while (left && right)
+        {
+            if (m_pool[left].priority > m_pool[right].priority)
+            {
+                m_path.push_back(left);
+                *hook = left;
+                hook = &m_pool[left].right;
+                left = m_pool[left].right;
+            }
+            else
+            {
+                m_path.push_back(right);
+                *hook = right;
+                hook = &m_pool[right].left;
+                right = m_pool[right].left;
+            }
+        }
+        *hook = left ? left : right;
+
+        m_pool.deallocate(node);
+        this->setChild(parent, val, merged);
+        this->recalcPath();
+
+        return weight;
     }
 
     std::vector<T> getRange(std::uint64_t l, std::uint64_t r) const
     {
         std::vector<T> res{};
 
-        this->getRange(m_root, 0, res, l, r);
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{};
+        std::uint32_t node = m_root;
+        std::uint64_t k = 0;
+        while (node)
+        {
+            std::uint64_t currPos = k + m_pool[m_pool[node].left].count;
+
+            if (l >= currPos + m_pool[node].weight)
+            {
+                k = currPos + m_pool[node].weight;
+                node = m_pool[node].right;
+                continue;
+            }
+
+            stack.push_back({ node, currPos });
+            if (l >= currPos)
+            {
+                break;
+            }
+            node = m_pool[node].left;
+        }
+
+        while (!stack.empty() && stack.back().second <= r)
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            const Node& currNode = m_pool[curr.first];
+            std::uint64_t first = std::max(l, curr.second);
+            std::uint64_t last = std::min(r, curr.second + currNode.weight - 1);
+            if (first <= last)
+            {
+                res.insert(res.end(), last - first + 1, currNode.val);
+            }
+
+            std::uint64_t rightK = curr.second + currNode.weight;
+            for (std::uint32_t child = currNode.right; child; child = m_pool[child].left)
+            {
+                stack.push_back({ child, rightK + m_pool[m_pool[child].left].count });
+            }
+        }
 
         return res;
     }
 
     T getKth(std::uint64_t k) const
     {
-        return k < this->size() ? this->getKth(m_root, k)->val : T{};
+        return k < this->size() ? m_pool[this->getKth(m_root, k)].val : T{};
     }
 
     T getRangeQuery(std::uint64_t l, std::uint64_t r) const
     {
         T res{};
 
-        this->getRangeQuery(m_root, 0, res, l, r);
+        if (l > r || l >= this->size())
+        {
+            return res;
+        }
+        r = std::min(r, this->size() - 1);
+
+        std::uint32_t node = m_root;
+        std::uint64_t k = 0;
+        std::uint64_t currPos = m_pool[m_pool[node].left].count;
+        while (r < currPos || l >= currPos + m_pool[node].weight)
+        {
+            if (r >= currPos)
+            {
+                k = currPos + m_pool[node].weight;
+                node = m_pool[node].right;
+            }
+            else
+            {
+                node = m_pool[node].left;
+            }
+
+            currPos = k + m_pool[m_pool[node].left].count;
+        }
+
+        T leftRes{};
+        std::uint32_t leftNode = m_pool[node].left;
+        std::uint64_t leftK = k;
+        while (leftNode)
+        {
+            const Node& currNode = m_pool[leftNode];
+            std::uint64_t pos = leftK + m_pool[currNode.left].count;
+
+            if (l <= leftK)
+            {
+                leftRes = T::calc(currNode.val, leftRes);
+                break;
+            }
+            if (l <= pos)
+            {
+                leftRes = T::calc(T::calc(T::calcMany(currNode.val, currNode.weight), m_pool[currNode.right].val), leftRes);
+                leftNode = currNode.left;
+            }
+            else if (l < pos + currNode.weight)
+            {
+                leftRes = T::calc(T::calc(T::calcMany(currNode.val, pos + currNode.weight - l), m_pool[currNode.right].val), leftRes);
+                break;
+            }
+            else
+            {
+                leftK = pos + currNode.weight;
+                leftNode = currNode.right;
+            }
+        }
+
+        res = T::calc(res, leftRes);
+        res = T::calc(res, T::calcMany(m_pool[node].val, std::min(r, currPos + m_pool[node].weight - 1) - std::max(l, currPos) + 1));
+
+        std::uint32_t rightNode = m_pool[node].right;
+        std::uint64_t rightK = currPos + m_pool[node].weight;
+        while (rightNode)
+        {
+            const Node& currNode = m_pool[rightNode];
+            std::uint64_t pos = rightK + m_pool[currNode.left].count;
+
+            if (rightK + currNode.count - 1 <= r)
+            {
+                res = T::calc(res, currNode.val);
+                break;
+            }
+            if (pos + currNode.weight - 1 <= r)
+            {
+                res = T::calc(res, m_pool[currNode.left].val);
+                res = T::calc(res, T::calcMany(currNode.val, currNode.weight));
+                rightK = pos + currNode.weight;
+                rightNode = currNode.right;
+            }
+            else if (r >= pos)
+            {
+                res = T::calc(res, m_pool[currNode.left].val);
+                res = T::calc(res, T::calcMany(currNode.val, r - pos + 1));
+                break;
+            }
+            else
+            {
+                rightNode = currNode.left;
+            }
+        }
 
         return res;
     }
 
+    std::uint64_t getDepth() const
+    {
+        if (!m_root)
+        {
+            return 0;
+        }
+
+        const FreeListPool<Node>& pool = m_pool;
+
+        std::uint64_t depth = 0;
+        std::vector<std::pair<std::uint32_t, std::uint64_t>> stack{ { m_root, 1 } };
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, std::uint64_t> curr = stack.back();
+            stack.pop_back();
+
+            depth = std::max(depth, curr.second);
+
+            if (pool[curr.first].left)
+            {
+                stack.push_back({ pool[curr.first].left, curr.second + 1 });
+            }
+            if (pool[curr.first].right)
+            {
+                stack.push_back({ pool[curr.first].right, curr.second + 1 });
+            }
+        }
+
+        return depth;
+    }
+
     std::uint64_t size() const
     {
-        return m_root ? m_root->count : (std::uint64_t)0;
+        return m_root ? m_pool[m_root].count : (std::uint64_t)0;
     }
 
     T getNearestSmaller(const T& val) const
     {
-        Node* res = nullptr;
+        std::uint32_t res = 0;
         this->getNearestSmaller(m_root, val, res);
 
-        return res ? res->val : T{};
+        return res ? m_pool[res].val : T{};
     }
 
     T getNearestBigger(const T& val) const
     {
-        Node* res = nullptr;
+        std::uint32_t res = 0;
         this->getNearestBigger(m_root, val, res);
 
-        return res ? res->val : T{};
+        return res ? m_pool[res].val : T{};
     }
 
     std::uint64_t getSmallestK(const T& val) const
     {
         std::uint64_t counter = 0;
-        Node* res = this->getSmallestK(m_root, val, counter);
+        std::uint32_t res = this->getSmallestK(m_root, val, counter);
 
         return res ? counter : this->size();
     }
@@ -127,392 +470,524 @@ public:
     std::uint64_t getBiggestK(const T& val) const
     {
         std::uint64_t counter = 0;
-        Node* res = this->getBiggestK(m_root, val, counter);
+        std::uint32_t res = this->getBiggestK(m_root, val, counter);
 
         return res ? counter : this->size();
     }
 
-    ~Treap()
+    void unite(Treap&& treap, std::uint64_t tasksCount = 1)
     {
-        if (m_root)
+        if (this->size() < treap.size())
         {
-            delete m_root;
+            std::swap(*this, treap);
         }
+        if (!treap.m_root)
+        {
+            return;
+        }
+
+        std::uint32_t otherRoot = this->importNodes(treap.m_pool, treap.m_root);
+        treap = Treap{};
+
+        std::vector<std::uint32_t> freedNodes{};
+        m_root = this->uniteNodes(m_root, otherRoot, std::bit_width(tasksCount - 1), freedNodes);
+        this->deallocateNodes(freedNodes);
     }
 
-private:
-    class Node
+    void intersect(Treap&& treap, std::uint64_t tasksCount = 1)
     {
-    public:
-        Node(const T& nodeVal, std::uint64_t nodeWeight) :
-            val{ T::calcMany(nodeVal, nodeWeight) },
-            weight{ nodeWeight },
-            count{ nodeWeight },
-            priority{ (std::uint64_t)std::rand() }
+        if (this->size() < treap.size())
         {
+            std::swap(*this, treap);
         }
 
-        Node(const Node& node) :
-            val{ node.val },
-            priority{ node.priority },
-            weight{ node.weight },
-            count{ node.count },
-            left{ node.left ? new Node(*node.left) : nullptr },
-            right{ node.right ? new Node(*node.right) : nullptr }
-        {
-        }
+        std::uint32_t otherRoot = treap.m_root ? this->importNodes(treap.m_pool, treap.m_root) : 0;
+        treap = Treap{};
+
+        std::vector<std::uint32_t> freedNodes{};
+        m_root = this->intersectNodes(m_root, otherRoot, std::bit_width(tasksCount - 1), freedNodes);
+        this->deallocateNodes(freedNodes);
+    }
 
-        ~Node()
+    void subtract(Treap&& treap, std::uint64_t tasksCount = 1)
+    {
+        if (!m_root || !treap.m_root)
         {
-            if (left)
-            {
-                delete left;
-            }
-            if (right)
-            {
-                delete right;
-            }
+            treap = Treap{};
+            return;
         }
 
-        T val;
-        std::uint64_t priority;
-        std::uint64_t weight;
-        std::uint64_t count;
-        Node* left = nullptr;
-        Node* right = nullptr;
-    };
+        std::uint32_t otherRoot = this->importNodes(treap.m_pool, treap.m_root);
+        treap = Treap{};
 
+        std::vector<std::uint32_t> freedNodes{};
+        m_root = this->subtractNodes(m_root, otherRoot, std::bit_width(tasksCount - 1), freedNodes);
+        this->deallocateNodes(freedNodes);
+    }
 
-    Node* rightRotate(Node* y)
+    void reserve(std::uint64_t nodesCount)
     {
-        Node* x = y->left;
-        Node* t1 = x->left;
-        Node* t2 = x->right;
-        Node* t3 = y->right;
-
-        x->right = y;
-        y->left = t2;
+        m_pool.reserve(nodesCount);
+    }
 
-        y->val = T::calc(T::calcMany(y->val, y->weight), T::calc(t2 ? t2->val : T{}, t3 ? t3->val : T{}));
-        y->count = (t2 ? t2->count : 0) + (t3 ? t3->count : 0) + y->weight;
+private:
+    struct Node
+    {
+        T val{};
+        std::uint64_t priority = 0;
+        std::uint64_t weight = 0;
+        std::uint64_t count = 0;
+        std::uint32_t left = 0;
+        std::uint32_t right = 0;
+    };
 
-        x->val = T::calc(T::calcMany(x->val, x->weight), T::calc(t1 ? t1->val : T{}, y->val));
-        x->count = (t1 ? t1->count : 0) + y->count + x->weight;
+    static std::uint64_t getDefaultSeed()
+    {
+        static std::atomic<std::uint64_t> instancesCount{ 0 };
 
-        return x;
+        return Treap::mix(instancesCount.fetch_add(1, std::memory_order_relaxed));
     }
 
-    Node* leftRotate(Node* x)
+    static std::uint64_t mix(std::uint64_t val)
     {
-        Node* y = x->right;
-        Node* t1 = x->left;
-        Node* t2 = y->left;
-        Node* t3 = y->right;
+        val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9;
+        val = (val ^ (val >> 27)) * 0x94D049BB133111EB;
 
-        y->left = x;
-        x->right = t2;
+        return val ^ (val >> 31);
+    }
 
-        x->val = T::calc(T::calcMany(x->val, x->weight), T::calc(t1 ? t1->val : T{}, t2 ? t2->val : T{}));
-        x->count = (t1 ? t1->count : 0) + (t2 ? t2->count : 0) + x->weight;
+    std::uint64_t getPriority()
+    {
+        m_seed += 0x9E3779B97F4A7C15;
 
-        y->val = T::calc(T::calcMany(y->val, y->weight), T::calc(x->val, t3 ? t3->val : T{}));
-        y->count = x->count + (t3 ? t3->count : 0) + y->weight;
+        return Treap::mix(m_seed);
+    }
 
-        return y;
+    void recalc(std::uint32_t node)
+    {
+        Node& currNode = m_pool[node];
+
+        currNode.val = T::calc(T::calcMany(currNode.val, currNode.weight), T::calc(m_pool[currNode.left].val, m_pool[currNode.right].val));
+        currNode.count = m_pool[currNode.left].count + m_pool[currNode.right].count + currNode.weight;
     }
 
-    Node* insert(Node* node, const T& val, std::uint64_t count)
+    void setChild(std::uint32_t parent, const T& val, std::uint32_t child)
     {
-        if (!node)
+        if (!parent)
         {
-            node = new Node(val, count);
-        }
-        else if (val.key < node->val.key)
-        {
-            node->left = this->insert(node->left, val, count);
-            node->count += count;
-            node->val = T::calc(node->val, T::calcMany(val, count));
-
-            if (node->left->priority > node->priority)
-            {
-                node = this->rightRotate(node);
-            }
+            m_root = child;
         }
-        else if (val.key == node->val.key)
+        else if (val.key < m_pool[parent].val.key)
         {
-            node->count += count;
-            node->weight += count;
-            node->val = T::calc(node->val, T::calcMany(val, count));
+            m_pool[parent].left = child;
         }
         else
         {
-            node->right = this->insert(node->right, val, count);
-            node->count += count;
-            node->val = T::calc(node->val, T::calcMany(val, count));
-
-            if (node->right->priority > node->priority)
-            {
-                node = this->leftRotate(node);
-            }
+            m_pool[parent].right = child;
         }
-
-        return node;
     }
 
-    std::uint64_t count(Node* node, const T& val) const
+    void recalcPath()
     {
-        if (!node)
+        for (std::uint64_t i = m_path.size(); i > 0; i--)
         {
-            return 0;
+            this->recalc(m_path[i - 1]);
         }
-        if (node->val.key == val.key)
+    }
+
+    std::uint32_t getKth(std::uint32_t node, std::uint64_t k) const
+    {
+        std::uint64_t leftCount = m_pool[m_pool[node].left].count;
+
+        if (k < leftCount)
         {
-            return node->weight;
+            return this->getKth(m_pool[node].left, k);
         }
-        if (node->val.key < val.key)
+
+        if (m_pool[node].right && k >= leftCount + m_pool[node].weight)
         {
-            return this->count(node->right, val);
+            return this->getKth(m_pool[node].right, k - leftCount - m_pool[node].weight);
         }
 
-        return this->count(node->left, val);
+        return node;
     }
 
-    std::pair<Node*, std::uint64_t> erase(Node* node, const T& val, std::uint64_t count)
+    void getNearestSmaller(std::uint32_t node, const T& val, std::uint32_t& current) const
     {
         if (!node)
         {
-            return std::pair<Node*, std::uint64_t>{ nullptr, 0 };
+            return;
+        }
+
+        if (!current || val.key < m_pool[current].val.key || (m_pool[node].val.key <= val.key && m_pool[current].val.key < m_pool[node].val.key))
+        {
+            current = node;
         }
-        if (val.key < node->val.key)
+
+        if (val.key < m_pool[node].val.key)
         {
-            std::pair<Node*, std::uint64_t> data = this->erase(node->left, val, count);
-            node->left = data.first;
-            node->count -= data.second;
-            node->val = T::calc(T::calcMany(node->val, node->weight), T::calc(node->left ? node->left->val : T{}, node->right ? node->right->val : T{}));
+            this->getNearestSmaller(m_pool[node].left, val, current);
 
-            return std::pair<Node*, std::uint64_t>{ node, data.second };
+            return;
         }
-        if (val.key > node->val.key)
+
+        while (m_pool[current].right && m_pool[m_pool[current].right].val.key <= val.key)
         {
-            std::pair<Node*, std::uint64_t> data = this->erase(node->right, val, count);
-            node->right = data.first;
-            node->count -= data.second;
-            node->val = T::calc(T::calcMany(node->val, node->weight), T::calc(node->left ? node->left->val : T{}, node->right ? node->right->val : T{}));
+            current = m_pool[current].right;
+        }
 
-            return std::pair<Node*, std::uint64_t>{ node, data.second };
+        if (m_pool[current].right)
+        {
+            this->getNearestSmaller(m_pool[m_pool[current].right].left, val, current);
         }
-        if (count < node->weight)
+    }
+
+    void getNearestBigger(std::uint32_t node, const T& val, std::uint32_t& current) const
+    {
+        if (!node)
         {
-            node->weight -= count;
-            node->count -= count;
-            node->val = T::calc(T::calcMany(node->val, node->weight), T::calc(node->left ? node->left->val : T{}, node->right ? node->right->val : T{}));
+            return;
+        }
 
-            return std::pair<Node*, std::uint64_t>{ node, count };
+        if (!current || val.key > m_pool[current].val.key || (m_pool[node].val.key >= val.key && m_pool[current].val.key > m_pool[node].val.key))
+        {
+            current = node;
         }
-        if (!node->left)
+
+        if (val.key > m_pool[node].val.key)
         {
-            Node* temp = node->right;
-            node->right = nullptr;
-            std::uint64_t nodeWeight = node->weight;
-            delete node;
+            this->getNearestBigger(m_pool[node].right, val, current);
 
-            return std::pair<Node*, std::uint64_t>{ temp, nodeWeight };
+            return;
         }
-        if (!node->right)
+
+        while (m_pool[current].left && m_pool[m_pool[current].left].val.key >= val.key)
         {
-            Node* temp = node->left;
-            node->left = nullptr;
-            std::uint64_t nodeWeight = node->weight;
-            delete node;
+            current = m_pool[current].left;
+        }
 
-            return std::pair<Node*, std::uint64_t>{ temp, nodeWeight };
+        if (m_pool[current].left)
+        {
+            this->getNearestBigger(m_pool[m_pool[current].left].right, val, current);
         }
-        if (node->left->priority < node->right->priority)
+    }
+
+    std::uint32_t getSmallestK(std::uint32_t node, const T& val, std::uint64_t& counter) const
+    {
+        if (!node)
         {
-            node = this->leftRotate(node);
+            return 0;
+        }
 
-            std::pair<Node*, std::uint64_t> data = this->erase(node->left, val, count);
-            node->left = data.first;
-            node->count -= data.second;
-            node->val = T::calc(T::calcMany(node->val, node->weight), T::calc(node->left ? node->left->val : T{}, node->right ? node->right->val : T{}));
+        if (m_pool[node].val.key == val.key)
+        {
+            counter += m_pool[m_pool[node].left].count;
 
-            return std::pair<Node*, std::uint64_t>{ node, data.second };
+            return node;
         }
 
-        node = this->rightRotate(node);
+        if (val.key < m_pool[node].val.key)
+        {
+            return this->getSmallestK(m_pool[node].left, val, counter);
+        }
 
-        std::pair<Node*, std::uint64_t> data = this->erase(node->right, val, count);
-        node->right = data.first;
-        node->count -= data.second;
-        node->val = T::calc(T::calcMany(node->val, node->weight), T::calc(node->left ? node->left->val : T{}, node->right ? node->right->val : T{}));
+        counter += m_pool[m_pool[node].left].count + m_pool[node].weight;
 
-        return std::pair<Node*, std::uint64_t>{ node, data.second };
+        return this->getSmallestK(m_pool[node].right, val, counter);
     }
 
-    void getRange(Node* node, std::uint64_t k, std::vector<T>& res, std::uint64_t l, std::uint64_t r) const
+    std::uint32_t getBiggestK(std::uint32_t node, const T& val, std::uint64_t& counter) const
     {
-        if (!node || k > r || k + node->count <= l)
+        if (!node)
         {
-            return;
+            return 0;
         }
 
-        std::uint64_t currPos = k + (node->left ? node->left->count : 0);
-        std::int64_t minus = 
-            std::min((std::int64_t)currPos - (std::int64_t)l, (std::int64_t)0)
-            + std::min((std::int64_t)r - (std::int64_t)(currPos + node->weight - 1), (std::int64_t)0);
+        if (m_pool[node].val.key == val.key)
+        {
+            counter += m_pool[m_pool[node].left].count + m_pool[node].weight - 1;
 
-        this->getRange(node->left, k, res, l, r);
-        res.insert(res.end(), std::max((std::int64_t)node->weight + minus, (std::int64_t)0), node->val);
-        this->getRange(node->right, currPos + node->weight, res, l, r);
-    }
+            return node;
+        }
 
-    Node* getKth(Node* node, std::uint64_t k) const
-    {
-        if (node->left && k < node->left->count)
+        if (val.key < m_pool[node].val.key)
         {
-            return this->getKth(node->left, k);
+            return this->getBiggestK(m_pool[node].left, val, counter);
         }
 
-        if (node->right && k >= (node->left ? node->left->count : 0) + node->weight)
+        counter += m_pool[m_pool[node].left].count + m_pool[node].weight;
+
+        return this->getBiggestK(m_pool[node].right, val, counter);
+    }
+
+    std::uint32_t importNodes(const FreeListPool<Node>& otherPool, std::uint32_t otherRoot)
+    {
+        std::uint32_t root = m_pool.allocate(otherPool[otherRoot]);
+
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack{ { otherRoot, root } };
+        while (!stack.empty())
         {
-            return this->getKth(node->right, k - (node->left ? node->left->count : 0) - node->weight);
+            std::pair<std::uint32_t, std::uint32_t> curr = stack.back();
+            stack.pop_back();
+
+            std::uint32_t left = otherPool[curr.first].left ? m_pool.allocate(otherPool[otherPool[curr.first].left]) : 0;
+            std::uint32_t right = otherPool[curr.first].right ? m_pool.allocate(otherPool[otherPool[curr.first].right]) : 0;
+
+            m_pool[curr.second].left = left;
+            m_pool[curr.second].right = right;
+
+            if (left)
+            {
+                stack.push_back({ otherPool[curr.first].left, left });
+            }
+            if (right)
+            {
+                stack.push_back({ otherPool[curr.first].right, right });
+            }
         }
 
-        return node;
+        return root;
     }
 
-    void getRangeQuery(Node* node, std::uint64_t k, T& res, std::uint64_t l, std::uint64_t r) const
+    void collectNodes(std::uint32_t node, std::vector<std::uint32_t>& freedNodes) const
     {
-        if (!node || k > r || k + node->count <= l)
+        if (!node)
         {
             return;
         }
 
-        std::uint64_t currPos = k + (node->left ? node->left->count : 0);
-        std::int64_t minus =
-            std::min((std::int64_t)currPos - (std::int64_t)l, (std::int64_t)0)
-            + std::min((std::int64_t)r - (std::int64_t)(currPos + node->weight - 1), (std::int64_t)0);
+        std::uint64_t begin = freedNodes.size();
+        freedNodes.push_back(node);
 
-        if (l <= k && k + node->count - 1 <= r)
+        for (std::uint64_t i = begin; i < freedNodes.size(); i++)
         {
-            res = T::calc(res, node->val);
-            return;
+            if (m_pool[freedNodes[i]].left)
+            {
+                freedNodes.push_back(m_pool[freedNodes[i]].left);
+            }
+            if (m_pool[freedNodes[i]].right)
+            {
+                freedNodes.push_back(m_pool[freedNodes[i]].right);
+            }
         }
+    }
 
-        this->getRangeQuery(node->left, k, res, l, r);
-        res = T::calc(res, T::calcMany(node->val, std::max((std::int64_t)node->weight + minus, (std::int64_t)0)));
-        this->getRangeQuery(node->right, currPos + node->weight, res, l, r);
+    void deallocateNodes(const std::vector<std::uint32_t>& freedNodes)
+    {
+        for (std::uint32_t node : freedNodes)
+        {
+            m_pool.deallocate(node);
+        }
     }
 
-    void getNearestSmaller(Node* node, const T& val, Node*& current) const
+    void split(std::uint32_t node, const T& val, std::uint32_t& left, std::uint32_t& equal, std::uint32_t& right)
     {
         if (!node)
         {
+            left = equal = right = 0;
             return;
         }
 
-        if (!current || val.key < current->val.key || (node->val.key <= val.key && current->val.key < node->val.key))
+        std::uint32_t temp = 0;
+        if (val.key < m_pool[node].val.key)
         {
-            current = node;
+            this->split(m_pool[node].left, val, left, equal, temp);
+            m_pool[node].left = temp;
+            this->recalc(node);
+            right = node;
         }
-
-        if (val.key < node->val.key)
+        else if (val.key > m_pool[node].val.key)
         {
-            this->getNearestSmaller(node->left, val, current);
+            this->split(m_pool[node].right, val, temp, equal, right);
+            m_pool[node].right = temp;
+            this->recalc(node);
+            left = node;
+        }
+        else
+        {
+            left = m_pool[node].left;
+            right = m_pool[node].right;
+            equal = node;
 
-            return;
+            m_pool[node].left = 0;
+            m_pool[node].right = 0;
+            this->recalc(node);
         }
+    }
 
-        while (current->right && current->right->val.key <= val.key)
+    std::uint32_t mergeNodes(std::uint32_t left, std::uint32_t right)
+    {
+        if (!left || !right)
         {
-            current = current->right;
+            return left ? left : right;
         }
 
-        if (current->right)
+        if (m_pool[left].priority > m_pool[right].priority)
         {
-            this->getNearestSmaller(current->right->left, val, current);
+            m_pool[left].right = this->mergeNodes(m_pool[left].right, right);
+            this->recalc(left);
+
+            return left;
         }
+
+        m_pool[right].left = this->mergeNodes(left, m_pool[right].left);
+        this->recalc(right);
+
+        return right;
     }
 
-    void getNearestBigger(Node* node, const T& val, Node*& current) const
+    std::uint32_t joinNodes(std::uint32_t left, std::uint32_t mid, std::uint32_t right)
     {
-        if (!node)
+        if (m_pool[mid].priority >= m_pool[left].priority && m_pool[mid].priority >= m_pool[right].priority)
         {
-            return;
+            m_pool[mid].left = left;
+            m_pool[mid].right = right;
+            this->recalc(mid);
+
+            return mid;
         }
 
-        if (!current || val.key > current->val.key || (node->val.key >= val.key && current->val.key > node->val.key))
+        if (m_pool[left].priority > m_pool[right].priority)
         {
-            current = node;
+            m_pool[left].right = this->joinNodes(m_pool[left].right, mid, right);
+            this->recalc(left);
+
+            return left;
         }
 
-        if (val.key > node->val.key)
+        m_pool[right].left = this->joinNodes(left, mid, m_pool[right].left);
+        this->recalc(right);
+
+        return right;
+    }
+
+    std::pair<std::uint32_t, std::uint32_t> forkJoin(std::uint32_t (Treap::*func)(std::uint32_t, std::uint32_t, std::uint64_t, std::vector<std::uint32_t>&),
+        std::uint32_t firstLeft, std::uint32_t secondLeft, std::uint32_t firstRight, std::uint32_t secondRight, std::uint64_t depth, std::vector<std::uint32_t>& freedNodes)
+    {
+        std::uint64_t nodesCount = m_pool[firstLeft].count + m_pool[secondLeft].count + m_pool[firstRight].count + m_pool[secondRight].count;
+        if (!depth || nodesCount < m_minParallelCount)
         {
-            this->getNearestBigger(node->right, val, current);
+            std::uint32_t left = (this->*func)(firstLeft, secondLeft, 0, freedNodes);
+            std::uint32_t right = (this->*func)(firstRight, secondRight, 0, freedNodes);
 
-            return;
+            return std::pair<std::uint32_t, std::uint32_t>{ left, right };
         }
 
-        while (current->left && current->left->val.key >= val.key)
+        std::vector<std::uint32_t> leftFreedNodes{};
+        std::future<std::uint32_t> leftTask = std::async(std::launch::async, [this, func, firstLeft, secondLeft, depth, &leftFreedNodes]()
+            {
+                return (this->*func)(firstLeft, secondLeft, depth - 1, leftFreedNodes);
+            });
+
+        std::uint32_t right = (this->*func)(firstRight, secondRight, depth - 1, freedNodes);
+        std::uint32_t left = leftTask.get();
+
+        freedNodes.insert(freedNodes.end(), leftFreedNodes.begin(), leftFreedNodes.end());
+
+        return std::pair<std::uint32_t, std::uint32_t>{ left, right };
+    }
+
+    std::uint32_t uniteNodes(std::uint32_t first, std::uint32_t second, std::uint64_t depth, std::vector<std::uint32_t>& freedNodes)
+    {
+        if (!first || !second)
         {
-            current = current->left;
+            return first ? first : second;
         }
 
-        if (current->left)
+        if (m_pool[first].priority < m_pool[second].priority)
         {
-            this->getNearestBigger(current->left->right, val, current);
+            std::swap(first, second);
         }
+
+        std::uint32_t left = 0, equal = 0, right = 0;
+        this->split(second, m_pool[first].val, left, equal, right);
+
+        if (equal)
+        {
+            m_pool[first].weight += m_pool[equal].weight;
+            freedNodes.push_back(equal);
+        }
+
+        std::pair<std::uint32_t, std::uint32_t> children = this->forkJoin(&Treap::uniteNodes, m_pool[first].left, left, m_pool[first].right, right, depth, freedNodes);
+        m_pool[first].left = children.first;
+        m_pool[first].right = children.second;
+        this->recalc(first);
+
+        return first;
     }
 
-    Node* getSmallestK(Node* node, const T& val, std::uint64_t& counter) const
+    std::uint32_t intersectNodes(std::uint32_t first, std::uint32_t second, std::uint64_t depth, std::vector<std::uint32_t>& freedNodes)
     {
-        if (!node)
+        if (!first || !second)
         {
-            return nullptr;
+            this->collectNodes(first ? first : second, freedNodes);
+
+            return 0;
         }
 
-        if (node->val.key == val.key)
+        if (m_pool[first].priority < m_pool[second].priority)
         {
-            counter += (node->left ? node->left->count : 0);
-
-            return node;
+            std::swap(first, second);
         }
 
-        if (val.key < node->val.key)
+        std::uint32_t left = 0, equal = 0, right = 0;
+        this->split(second, m_pool[first].val, left, equal, right);
+
+        std::pair<std::uint32_t, std::uint32_t> children = this->forkJoin(&Treap::intersectNodes, m_pool[first].left, left, m_pool[first].right, right, depth, freedNodes);
+
+        if (!equal)
         {
-            return this->getSmallestK(node->left, val, counter);
+            freedNodes.push_back(first);
+
+            return this->mergeNodes(children.first, children.second);
         }
 
-        counter += (node->left ? node->left->count : 0) + node->weight;
+        m_pool[first].weight = std::min(m_pool[first].weight, m_pool[equal].weight);
+        freedNodes.push_back(equal);
+
+        m_pool[first].left = children.first;
+        m_pool[first].right = children.second;
+        this->recalc(first);
 
-        return this->getSmallestK(node->right, val, counter);
+        return first;
     }
 
-    Node* getBiggestK(Node* node, const T& val, std::uint64_t& counter) const
+    std::uint32_t subtractNodes(std::uint32_t first, std::uint32_t second, std::uint64_t depth, std::vector<std::uint32_t>& freedNodes)
     {
-        if (!node)
+        if (!first || !second)
         {
-            return nullptr;
+            this->collectNodes(second, freedNodes);
+
+            return first;
         }
 
-        if (node->val.key == val.key)
+        std::uint32_t left = 0, equal = 0, right = 0;
+        this->split(first, m_pool[second].val, left, equal, right);
+
+        std::pair<std::uint32_t, std::uint32_t> children = this->forkJoin(&Treap::subtractNodes, left, m_pool[second].left, right, m_pool[second].right, depth, freedNodes);
+        freedNodes.push_back(second);
+
+        if (equal && m_pool[equal].weight > m_pool[second].weight)
         {
-            counter += (node->left ? node->left->count : 0) + node->weight - 1;
+            m_pool[equal].weight -= m_pool[second].weight;
 
-            return node;
+            return this->joinNodes(children.first, equal, children.second);
         }
 
-        if (val.key < node->val.key)
+        if (equal)
         {
-            return this->getBiggestK(node->left, val, counter);
+            freedNodes.push_back(equal);
         }
 
-        counter += (node->left ? node->left->count : 0) + node->weight;
-
-        return this->getBiggestK(node->right, val, counter);
+        return this->mergeNodes(children.first, children.second);
     }
 
-    Node* m_root = nullptr;
+    static constexpr std::uint64_t m_minParallelCount = 1 << 14;
+
+    FreeListPool<Node> m_pool{};
+    std::uint32_t m_root = 0;
+    std::uint64_t m_seed = Treap::getDefaultSeed();
+    std::vector<std::uint32_t> m_path{};
 };
 
 struct Key
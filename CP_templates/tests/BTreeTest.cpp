@@ -0,0 +1,135 @@
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <utility>
+
+#include "../BTree.h"
+
+struct PairKey
+{
+    PairKey() = default;
+
+    PairKey(const std::pair<int, int>& val) :
+        key{ val }
+    {
+    }
+
+    std::pair<int, int> key{};
+
+    static PairKey calc(const PairKey& firstKey, const PairKey& secondKey)
+    {
+        return PairKey(firstKey.key);
+    }
+
+    static PairKey calcMany(const PairKey& key, std::uint64_t count)
+    {
+        return PairKey(key.key);
+    }
+};
+
+struct DoubleKey
+{
+    DoubleKey() = default;
+
+    DoubleKey(double val) :
+        key{ val }
+    {
+    }
+
+    double key = 0;
+
+    static DoubleKey calc(const DoubleKey& firstKey, const DoubleKey& secondKey)
+    {
+        return DoubleKey(firstKey.key);
+    }
+
+    static DoubleKey calcMany(const DoubleKey& key, std::uint64_t count)
+    {
+        return DoubleKey(key.key);
+    }
+};
+
+template <typename T, typename KeyType>
+void checkAgainstMap(BTree<T>& bTree, const std::map<KeyType, std::uint64_t>& counts)
+{
+    std::uint64_t rank = 0;
+    for (const auto& [key, count] : counts)
+    {
+        assert(bTree.count(T(key)) == count);
+        assert(bTree.getSmallestK(T(key)) == rank);
+        assert(bTree.getKth(rank).key == key);
+
+        rank += count;
+    }
+
+    assert(bTree.size() == rank);
+}
+
+void testPairKeys()
+{
+    BTree<PairKey> bTree;
+    std::map<std::pair<int, int>, std::uint64_t> counts;
+
+    for (int i = 0; i < 100; i++)
+    {
+        bTree.insert(PairKey({ i, i }));
+        counts[{ i, i }]++;
+    }
+
+    bTree.insert(PairKey({ -5, -5 }));
+    counts[{ -5, -5 }]++;
+    checkAgainstMap(bTree, counts);
+
+    std::mt19937 gen(1);
+    for (int i = 0; i < 20000; i++)
+    {
+        std::pair<int, int> key{ (int)(gen() % 2001) - 1000, (int)(gen() % 3) - 1 };
+        if (gen() % 3)
+        {
+            bTree.insert(PairKey(key));
+            counts[key]++;
+        }
+        else if (counts.count(key))
+        {
+            assert(bTree.erase(PairKey(key)) == 1);
+            if (!--counts[key])
+            {
+                counts.erase(key);
+            }
+        }
+    }
+
+    checkAgainstMap(bTree, counts);
+}
+
+void testInfiniteKeys()
+{
+    BTree<DoubleKey> bTree;
+    std::map<double, std::uint64_t> counts;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        bTree.insert(DoubleKey(i * 0.5));
+        counts[i * 0.5]++;
+    }
+
+    bTree.insert(DoubleKey(-std::numeric_limits<double>::infinity()));
+    counts[-std::numeric_limits<double>::infinity()]++;
+    bTree.insert(DoubleKey(std::numeric_limits<double>::lowest()));
+    counts[std::numeric_limits<double>::lowest()]++;
+    checkAgainstMap(bTree, counts);
+
+    assert(bTree.erase(DoubleKey(-std::numeric_limits<double>::infinity())) == 1);
+    counts.erase(-std::numeric_limits<double>::infinity());
+    checkAgainstMap(bTree, counts);
+}
+
+int main()
+{
+    testPairKeys();
+    testInfiniteKeys();
+
+    return 0;
+}